@@ -1 +1 @@
-qemu-system-i386 -debugcon stdio -m 64M -fda build/main.img
\ No newline at end of file
+qemu-system-i386 -debugcon stdio -m 64M -smp 4 -fda build/main.img
\ No newline at end of file
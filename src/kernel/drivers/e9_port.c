@@ -22,13 +22,7 @@
 #include <hal/pit.h>
 #include <scheduler/multitask.h>
 
-mutex_t e9_lock = {
-    .owner = NULL,
-    .locked_count = 0,
-    .locked = false,
-    .last_waiting_list = NULL,
-    .first_waiting_list = NULL
-};
+mutex_t e9_lock = MUTEX_INIT("e9");
 
 void E9_putc(char c)
 {
@@ -21,19 +21,21 @@
 #include <hal/dma.h>
 #include <hal/irq.h>
 #include <hal/pit.h>
-#include <hal/pic.h>
 #include <hal/io.h>
 #include <memmgr/physmem_manager.h>
 #include <scheduler/multitask.h>
+#include <scheduler/waitqueue.h>
 #include <debug.h>
 #include <stddef.h>
 #include <memory.h>
+#include <trace.h>
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
 //============================================================================
 
 #define TIMEOUT 1000
+#define IRQ_TIMEOUT_MS 2000     // the motor may have to spin up first
 #define FDC_CHANNEL 2
 #define FDC_BUFFER_BLOCKSIZE (64 / 4)
 #define FDC_SECTOR_PER_TRACK 18
@@ -116,6 +118,7 @@ typedef enum {
 //============================================================================
 
 bool g_irqFired = false;
+wait_queue_t g_irqQueue;        // tasks waiting for the FDC irq
 uint8_t g_currentDrive = 0;
 uint32_t* fdc_buffer = NULL;
 mutex_t* fdc_lock;
@@ -149,19 +152,18 @@ void FDC_interruptHandler(Registers regs)
     g_irqFired = true;
 
     // send EOI
-    PIC_sendEndOfInterrupt(6);
+    IRQ_sendEndOfInterrupt(6);
+
+    wake_up_all(&g_irqQueue);
 }
 
 bool FDC_waitIrq()
 {
-    uint32_t timeout = TIMEOUT;
-    while (!g_irqFired && timeout--);
-
-    if (timeout == 0)
-        return false; // timed out
+    // sleep until the irq, no more busy waiting
+    bool fired = wait_event_timeout(&g_irqQueue, g_irqFired, IRQ_TIMEOUT_MS);
 
     g_irqFired = false;
-    return true;
+    return fired;
 }
 
 void FDC_initializeDma(uint32_t phys_buffer, uint32_t count)
@@ -459,11 +461,13 @@ void fdc_lba2chs(uint32_t lba, uint16_t* cylinderOut, uint16_t* sectorOut, uint1
 void FDC_readSectors(void* buffer, uint16_t lba, uint8_t sector_count)
 {
     uint16_t cylinder, sector, head;
+    uint16_t first_lba = lba;
 
     if(sector_count > 128 || (lba + sector_count) > 2880)
         return;     // cannot read we only have 64k of buffer or out of range !
 
     acquire_mutex(fdc_lock);
+    trace(TRACE_FDC_READ, lba, sector_count);
     FDC_controlMotor(true);
 
     for (size_t i = 0; i < sector_count; i++)
@@ -478,6 +482,7 @@ void FDC_readSectors(void* buffer, uint16_t lba, uint8_t sector_count)
     FDC_controlMotor(false);
 
     memcpy(buffer, fdc_buffer, sector_count*512);
+    trace(TRACE_FDC_DONE, first_lba, sector_count);
     release_mutex(fdc_lock);
 }
 
@@ -485,7 +490,8 @@ void FDC_initialize()
 {
     log_info("kernel", "Initializing FDC...");
 
-    fdc_lock = create_mutex();
+    fdc_lock = create_named_mutex("fdc");
+    wait_queue_init(&g_irqQueue);
 
     fdc_buffer = (uint32_t*)PHYSMEM_AllocBlocks(FDC_BUFFER_BLOCKSIZE); // Let’s hope it doesn’t go over 16MB.
 
@@ -20,10 +20,12 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <hal/irq.h>
-#include <hal/pic.h>
 #include <hal/io.h>
 #include <drivers/keyboard.h>
+#include <ring_buffer.h>
 #include <scheduler/multitask.h>
+#include <scheduler/waitqueue.h>
+#include <scheduler/workqueue.h>
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
@@ -72,11 +74,14 @@ typedef enum{
 }TYPEMATIC_RATE;
 
 
+#define KEY_BUFFER_SIZE 64  // power of two (ring buffer)
+
 //============================================================================
 //    IMPLEMENTATION PRIVATE DATA
 //============================================================================
 
 mutex_t* keyboard_lock;
+wait_queue_t g_keyQueue;    // tasks waiting for a key press
 
 bool g_keyboard_stateDisabled = false;
 bool g_shiftPressed = false;
@@ -84,7 +89,11 @@ bool g_capsLockOn = false;
 bool g_numLockOn = false;
 bool g_scrollOn = false;
 bool g_extended = false;
-KEYCODE g_scancode = NULL_KEY;
+KEYCODE g_scancode = NULL_KEY;     // last byte received, irq handler only
+
+// make codes, filled by the irq handler and read by a single consumer task
+uint8_t g_keyStorage[KEY_BUFFER_SIZE];
+ring_buffer_t g_keys;
 
 static char asciiTable[128] = {
     0,  27, '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b',
@@ -117,6 +126,7 @@ void KEYBOARD_setTypematicMode(TYPEMATIC_DELAY delay, TYPEMATIC_RATE rate);
 bool KEYBOARD_selfTest();
 bool KEYBOARD_interfaceTest();
 void KEYBOARD_interruptHandler(Registers* regs);
+void KEYBOARD_updateLedWork(void* arg);
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE FUNCTIONS
@@ -187,6 +197,12 @@ bool KEYBOARD_interfaceTest()
         return false;
 }
 
+// deferred from the irq handler, runs in the work queue thread
+void KEYBOARD_updateLedWork(void* arg)
+{
+    KEYBOARD_updateLed(g_numLockOn, g_capsLockOn, g_scrollOn);
+}
+
 void KEYBOARD_interruptHandler(Registers* regs)
 {
     g_scancode = KEYBOARD_readOutputBuffer();
@@ -225,6 +241,9 @@ void KEYBOARD_interruptHandler(Registers* regs)
     else
     {
         // MAKE CODE (key pressed)
+        uint8_t key = g_scancode;
+        ring_buffer_push(&g_keys, &key);    // no lock, the consumer never disables interrupts
+
         if (g_extended)
         {
             // handling special keys like arrows etc.
@@ -236,11 +255,11 @@ void KEYBOARD_interruptHandler(Registers* regs)
             {
             case CAPSLOCK_PRESSED:
                 g_capsLockOn ^= true;
-                KEYBOARD_updateLed(g_numLockOn, g_capsLockOn, g_scrollOn);
+                schedule_work(KEYBOARD_updateLedWork, NULL);   // slow controller handshake, not in the irq
                 break;
             case NUMLOCK_PRESSED:
                 g_numLockOn ^= true;
-                KEYBOARD_updateLed(g_numLockOn, g_capsLockOn, g_scrollOn);
+                schedule_work(KEYBOARD_updateLedWork, NULL);
                 break;
 
             case LSHIFT_PRESSED:
@@ -259,7 +278,9 @@ void KEYBOARD_interruptHandler(Registers* regs)
 
 End:
     // send EOI
-    PIC_sendEndOfInterrupt(1);
+    IRQ_sendEndOfInterrupt(1);
+
+    wake_up_all(&g_keyQueue);
 }
 
 //============================================================================
@@ -286,27 +307,47 @@ void KEYBOARD_enable()
     release_mutex(keyboard_lock);
 }
 
+/*
+ * The key buffer has a single consumer: only one task at a time may read
+ * the keyboard (the shell or whoever owns the console).
+ */
 void KEYBOARD_discardLastKey()
 {
-    acquire_mutex(keyboard_lock);
-    g_scancode = NULL_KEY;
-    release_mutex(keyboard_lock);
+    uint8_t key;
+    ring_buffer_pop(&g_keys, &key);
 }
 
+// oldest key not read yet, NULL_KEY if there is none
 KEYCODE KEYBOARD_getLastKey()
 {
-    acquire_mutex(keyboard_lock);
+    uint8_t key;
 
-    return g_scancode;
+    if(!ring_buffer_peek(&g_keys, &key))
+        return NULL_KEY;
 
-    release_mutex(keyboard_lock);
+    return key;
+}
+
+bool KEYBOARD_hasKey()
+{
+    return !ring_buffer_empty(&g_keys);
+}
+
+// block (without using the cpu) until there is a key to read
+KEYCODE KEYBOARD_waitForKey()
+{
+    wait_event(&g_keyQueue, !ring_buffer_empty(&g_keys));
+
+    return KEYBOARD_getLastKey();
 }
 
 void KEYBOARD_initialize()
 {
     log_info("kernel", "Initializing Keyboard...");
 
-    keyboard_lock = create_mutex();
+    keyboard_lock = create_named_mutex("keyboard");
+    wait_queue_init(&g_keyQueue);
+    ring_buffer_init(&g_keys, g_keyStorage, sizeof(uint8_t), KEY_BUFFER_SIZE);
 
     disableInterrupts();
     KEYBOARD_enable(); // just in case !
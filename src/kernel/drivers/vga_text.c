@@ -36,13 +36,7 @@
 //    IMPLEMENTATION PRIVATE DATA
 //============================================================================
 
-mutex_t vga_lock = {
-    .owner = NULL,
-    .locked_count = 0,
-    .locked = false,
-    .last_waiting_list = NULL,
-    .first_waiting_list = NULL
-};
+mutex_t vga_lock = MUTEX_INIT("vga");
 
 uint16_t column = 0;
 uint16_t line = 0;
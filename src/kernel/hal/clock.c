@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <debug.h>
+#include <hal/io.h>
+#include <hal/pit.h>
+#include <hal/clock.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define CPUID_TSC               (1 << 4)    // leaf 1, edx
+#define CPUID_INVARIANT_TSC     (1 << 8)    // leaf 0x80000007, edx: constant rate in every power state
+#define CPUID_EXTENDED_LEAVES   0x80000000
+#define CPUID_POWER_MANAGEMENT  0x80000007
+
+#define CALIBRATION_MS          10
+#define CALIBRATION_RUNS        3           // the shortest wins: the others were disturbed (smi, host)
+
+#define NS_PER_TICK             (1000000000ULL / PIT_TICK_FREQUENCY)
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+bool g_hasTsc = false;
+bool g_invariantTsc = false;
+uint32_t g_tscKhz = 0;
+uint64_t g_bootTsc = 0;
+
+CLOCK_SOURCE g_clockSource = CLOCK_SOURCE_PIT;
+int64_t g_clockOffset = 0;     // keeps the time going on when the source changes
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+// time of the current source, without the offset
+static uint64_t source_ns()
+{
+    if(g_clockSource == CLOCK_SOURCE_PIT)
+        return getTickCount() * NS_PER_TICK;
+
+    // split: cycles * 1000000 would overflow after a few hours
+    uint64_t cycles = readTSC() - g_bootTsc;
+    return (cycles / g_tscKhz) * 1000000 + (cycles % g_tscKhz) * 1000000 / g_tscKhz;
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+void CLOCK_initialize()
+{
+    log_info("kernel", "Initializing the clocksource...");
+
+    uint32_t regs[4];
+
+    g_hasTsc = (readCpuidFeatures() & CPUID_TSC) != 0;
+    if(!g_hasTsc)
+    {
+        log_warn("kernel", "no time stamp counter, the clock ticks every ms");
+        return;
+    }
+
+    readCpuid(CPUID_EXTENDED_LEAVES, regs);
+    if(regs[0] >= CPUID_POWER_MANAGEMENT)
+    {
+        readCpuid(CPUID_POWER_MANAGEMENT, regs);
+        g_invariantTsc = (regs[3] & CPUID_INVARIANT_TSC) != 0;
+    }
+
+    uint64_t best = 0;
+    for(int i = 0; i < CALIBRATION_RUNS; i++)
+    {
+        uint64_t cycles = PIT_measureTsc(CALIBRATION_MS);
+        if(best == 0 || cycles < best)
+            best = cycles;
+    }
+
+    g_tscKhz = best / CALIBRATION_MS;
+    g_bootTsc = readTSC();
+
+    log_info("kernel", "tsc: %d khz, %s", g_tscKhz, g_invariantTsc ? "invariant" : "not invariant");
+
+    // a tsc that changes speed with the power state isn't a clock
+    if(g_invariantTsc && g_tscKhz != 0)
+        CLOCK_setSource(CLOCK_SOURCE_TSC);
+}
+
+// switch at run time (shell), the time stays continuous
+bool CLOCK_setSource(CLOCK_SOURCE source)
+{
+    if(source == CLOCK_SOURCE_TSC && g_tscKhz == 0)
+        return false;
+
+    uint32_t flags = disableInterruptsSave();
+
+    uint64_t now = clock_ns();
+    g_clockSource = source;
+    g_clockOffset = (int64_t)(now - source_ns());
+
+    restoreInterrupts(flags);
+    return true;
+}
+
+CLOCK_SOURCE CLOCK_getSource()
+{
+    return g_clockSource;
+}
+
+bool CLOCK_hasInvariantTsc()
+{
+    return g_invariantTsc;
+}
+
+// 0 without a time stamp counter
+uint32_t CLOCK_getTscKhz()
+{
+    return g_tscKhz;
+}
+
+// nanoseconds since boot, monotonic
+uint64_t clock_ns()
+{
+    return source_ns() + g_clockOffset;
+}
+
+// raw time stamp counter for cycle counts, the time in ns without one
+uint64_t clock_cycles()
+{
+    if(!g_hasTsc)
+        return clock_ns();
+
+    return readTSC();
+}
@@ -0,0 +1,81 @@
+; Copyright (C) 2025,  Novice
+;
+; This file is part of the Novix software.
+;
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+;
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+;
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+[bits 32]
+
+CR0_MP  equ 0x02    ; monitor coprocessor: wait/fwait also trap when TS is set
+CR0_EM  equ 0x04    ; emulation: every FPU instruction traps
+CR0_TS  equ 0x08    ; task switched
+CR0_NE  equ 0x20    ; native FPU errors (#MF) instead of the external irq 13
+
+; void FPU_enableUnit(uint32_t cr4_bits)
+global FPU_enableUnit
+FPU_enableUnit:
+    mov eax, cr0
+    and eax, ~(CR0_EM | CR0_TS)
+    or eax, CR0_MP | CR0_NE
+    mov cr0, eax
+
+    mov edx, [esp+4]
+    test edx, edx
+    jz .no_cr4          ; cr4 doesn't exist on every cpu
+    mov eax, cr4
+    or eax, edx
+    mov cr4, eax
+
+.no_cr4:
+    fninit
+    ret
+
+global FPU_setTaskSwitched
+FPU_setTaskSwitched:
+    mov eax, cr0
+    or eax, CR0_TS
+    mov cr0, eax
+    ret
+
+global FPU_clearTaskSwitched
+FPU_clearTaskSwitched:
+    clts
+    ret
+
+; the area is 512 bytes, 16 bytes aligned
+global FPU_fxsave
+FPU_fxsave:
+    mov eax, [esp+4]
+    fxsave [eax]
+    ret
+
+global FPU_fxrstor
+FPU_fxrstor:
+    mov eax, [esp+4]
+    fxrstor [eax]
+    ret
+
+; x87 only cpus, 108 bytes (fnsave also reinitializes the FPU)
+global FPU_fnsave
+FPU_fnsave:
+    mov eax, [esp+4]
+    fnsave [eax]
+    ret
+
+global FPU_frstor
+FPU_frstor:
+    mov eax, [esp+4]
+    frstor [eax]
+    ret
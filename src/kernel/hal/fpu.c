@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include <debug.h>
+#include <memory.h>
+#include <hal/fpu.h>
+#include <hal/io.h>
+
+/*
+ * x87/SSE state. The kernel itself never uses the FPU: the scheduler sets
+ * CR0.TS on every switch and the state of a task is only moved when it
+ * executes an FPU instruction (#NM, see multitask.c).
+ */
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define CPUID_FXSR          (1 << 24)
+#define CPUID_SSE           (1 << 25)
+
+#define CR4_OSFXSR          (1 << 9)    // fxsave/fxrstor and the SSE instructions are enabled
+#define CR4_OSXMMEXCPT      (1 << 10)   // SIMD exceptions are reported as #XM
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+bool g_fxsr = false;
+bool g_sse = false;
+
+// the state right after fninit, copied into every new task
+uint8_t g_cleanStateBuffer[FPU_STATE_SIZE + FPU_STATE_ALIGN - 1];
+uint8_t* g_cleanState = NULL;
+
+// fpu.asm
+void __attribute__((cdecl)) FPU_enableUnit(uint32_t cr4_bits);
+void __attribute__((cdecl)) FPU_fxsave(uint8_t* state);
+void __attribute__((cdecl)) FPU_fxrstor(uint8_t* state);
+void __attribute__((cdecl)) FPU_fnsave(uint8_t* state);
+void __attribute__((cdecl)) FPU_frstor(uint8_t* state);
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+// called by every cpu, the FPU is left usable (TS clear)
+void FPU_initialize()
+{
+    uint32_t features = readCpuidFeatures();
+    uint32_t cr4 = 0;
+
+    g_fxsr = (features & CPUID_FXSR) != 0;
+    g_sse = (features & CPUID_SSE) != 0;
+
+    if(g_fxsr)
+        cr4 |= CR4_OSFXSR;
+
+    if(g_sse)
+        cr4 |= CR4_OSXMMEXCPT;
+
+    FPU_enableUnit(cr4);
+
+    if(g_cleanState == NULL)
+    {
+        g_cleanState = FPU_ALIGN_STATE(g_cleanStateBuffer);
+        FPU_save(g_cleanState);
+
+        log_info("fpu", "%s", g_sse ? "x87 + SSE (fxsave)" : (g_fxsr ? "x87 (fxsave)" : "x87 (fnsave)"));
+    }
+}
+
+bool FPU_hasSse()
+{
+    return g_sse;
+}
+
+// a new task starts with the FPU as fninit leaves it (MXCSR masks every SIMD exception)
+void FPU_initState(uint8_t* state)
+{
+    memcpy(state, g_cleanState, FPU_STATE_SIZE);
+}
+
+void FPU_save(uint8_t* state)
+{
+    if(g_fxsr)
+        FPU_fxsave(state);
+    else
+        FPU_fnsave(state);
+}
+
+void FPU_restore(uint8_t* state)
+{
+    if(g_fxsr)
+        FPU_fxrstor(state);
+    else
+        FPU_frstor(state);
+}
@@ -17,7 +17,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <stddef.h>
 #include <hal/gdt.h>
+#include <hal/smp.h>
 #include <debug.h>
 #include <memory.h>
 
@@ -125,10 +127,10 @@ typedef enum{
 //============================================================================
 
 
-// one task state segment
-Tss_entry g_TSS;
+// one task state segment per cpu, the kernel stack is per cpu
+Tss_entry g_TSS[SMP_MAX_CPUS];
 
-Gdt_entry g_GDT[] = {
+Gdt_entry g_GDT[GDT_TSS_ENTRY + SMP_MAX_CPUS] = {
     // Null descriptor
     GDT_ENTRY(0, 0, 0, 0),
 
@@ -156,7 +158,7 @@ Gdt_entry g_GDT[] = {
             GDT_ACCESS_RW_BIT_ALLOW | GDT_ACCESS_UP_DIRECTION_BIT | GDT_ACCESS_EXECUTABLE_BIT_DATA | GDT_ACCESS_DESCRIPTOR_BIT_CODEDATA | GDT_ACCESS_DPL_RING3 | GDT_ACCESS_PRESENT_BIT,
             GDT_FLAG_LONG_MODE_CLEAR | GDT_FLAG_DB_32_BIT | GDT_FLAG_GRANULARITY_PAGE_BLOCK),
 
-    // Task state segment
+    // Task state segment of the boot cpu, the other cpus follow
     GDT_ENTRY(0, 
             0,
             1 | GDT_ACCESS_RW_BIT_NOTALLOW | GDT_ACCESS_UP_DIRECTION_BIT | GDT_ACCESS_EXECUTABLE_BIT_CODE | GDT_ACCESS_DESCRIPTOR_BIT_SYSTEM | GDT_ACCESS_DPL_RING0 | GDT_ACCESS_PRESENT_BIT,
@@ -176,34 +178,52 @@ void __attribute__((cdecl)) TSS_flush(uint8_t gdt_index);
 //    INTERFACE FUNCTIONS
 //============================================================================
 
-void write_tss(Gdt_entry *g)
+void write_tss(Gdt_entry *g, Tss_entry* tss)
 {
     // Compute the base and limit of the TSS for use in the GDT entry.
-	uint32_t base = (uint32_t) &g_TSS;
-	uint32_t limit = sizeof(g_TSS) - 1;
+	uint32_t base = (uint32_t) tss;
+	uint32_t limit = sizeof(Tss_entry) - 1;
 
     g->limit_low = limit & 0xffff;
     g->base_low = base & 0xffff;
     g->base_middle = (base >> 16) & 0xff;
+    g->access_byte = 1 | GDT_ACCESS_RW_BIT_NOTALLOW | GDT_ACCESS_UP_DIRECTION_BIT | GDT_ACCESS_EXECUTABLE_BIT_CODE | GDT_ACCESS_DESCRIPTOR_BIT_SYSTEM | GDT_ACCESS_DPL_RING0 | GDT_ACCESS_PRESENT_BIT;
     g->highLimit_flags = ((limit >> 16) & 0xf) | 0; // no flags needed
     g->base_high = (base >> 24) & 0xff;
 
-    memset(&g_TSS, 0, sizeof(g_TSS));
+    memset(tss, 0, sizeof(Tss_entry));
 
-    g_TSS.ss0 = 2 * 8;
-    g_TSS.esp0 = 0; // this is so invalid ...
+    tss->ss0 = 2 * 8;
+    tss->esp0 = 0; // this is so invalid ...
 }
 
+// kernel stack used by the calling cpu when an interrupt comes from ring 3
 void TSS_setKernelStack(uint32_t esp0)
 {
-    g_TSS.esp0 = esp0;
+    g_TSS[SMP_getCpuIndex()].esp0 = esp0;
+}
+
+// where the kernel stack of a cpu is kept, the sysenter entry reads it from there
+uint32_t* TSS_getKernelStackSlot(int cpu)
+{
+    // esp0 is 4 byte aligned in the tss, but a pointer to a packed member is not allowed
+    return (uint32_t*)((uint8_t*)&g_TSS[cpu] + offsetof(Tss_entry, esp0));
 }
 
 void GDT_initilize()
 {
     log_info("kernel", "Initializing the GDT...");
 
-    write_tss(&g_GDT[5]);
+    for(int cpu = 0; cpu < SMP_MAX_CPUS; cpu++)
+        write_tss(&g_GDT[GDT_TSS_ENTRY + cpu], &g_TSS[cpu]);
+
+    GDT_flush(&g_GDTdescriptor);
+    TSS_flush(GDT_TSS_ENTRY);
+}
+
+// the GDT is shared, each secondary cpu loads it with its own task state segment
+void GDT_loadCpu(int cpu)
+{
     GDT_flush(&g_GDTdescriptor);
-    TSS_flush(5);
+    TSS_flush(GDT_TSS_ENTRY + cpu);
 }
\ No newline at end of file
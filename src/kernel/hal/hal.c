@@ -23,7 +23,9 @@
 #include <hal/isr.h>
 #include <hal/irq.h>
 #include <hal/dma.h>
+#include <hal/fpu.h>
 #include <hal/syscall.h>
+#include <hal/clock.h>
 
 //============================================================================
 //    INTERFACE FUNCTIONS
@@ -35,6 +37,8 @@ void HAL_initialize(Boot_info* info)
     IDT_initilize();
     ISR_initialze();
     IRQ_initialize();
+    FPU_initialize();
     DMA_enable();
     SYSCALL_initialize();
+    CLOCK_initialize();
 }
\ No newline at end of file
@@ -67,5 +67,11 @@ void IDT_initilize()
 {
     log_info("kernel", "Initializing the IDT...");
 
+    IDT_flush(&g_IDTdescriptor);
+}
+
+// the IDT is shared, the secondary cpus only load it
+void IDT_load()
+{
     IDT_flush(&g_IDTdescriptor);
 }
\ No newline at end of file
@@ -49,4 +49,81 @@ disableInterrupts:
 global HLT
 HLT:
     hlt
+    ret
+
+; sti only takes effect after the next instruction, so no interrupt
+; can slip in between the two: the wake up can't be lost
+global enableInterruptsAndHLT
+enableInterruptsAndHLT:
+    sti
+    hlt
+    ret
+
+; selector of the loaded task state segment, one per cpu
+global readTaskRegister
+readTaskRegister:
+    xor eax, eax
+    str ax
+    ret
+
+; returns the old eflags, to give to restoreInterrupts
+global disableInterruptsSave
+disableInterruptsSave:
+    pushfd
+    pop eax
+    cli
+    ret
+
+global restoreInterrupts
+restoreInterrupts:
+    push dword [esp + 4]
+    popfd
+    ret
+
+; spin wait hint, lets the sibling hyperthread run
+global cpuRelax
+cpuRelax:
+    pause
+    ret
+
+; time stamp counter, returned in edx:eax
+global readTSC
+readTSC:
+    rdtsc
+    ret
+
+; feature flags of cpuid leaf 1 (edx)
+global readCpuidFeatures
+readCpuidFeatures:
+    push ebx            ; cpuid overwrites ebx, callee saved
+    mov eax, 1
+    cpuid
+    mov eax, edx
+    pop ebx
+    ret
+
+; void readCpuid(uint32_t leaf, uint32_t regs[4]): eax, ebx, ecx, edx
+global readCpuid
+readCpuid:
+    push ebx
+    push edi
+    mov eax, [esp + 12]
+    mov edi, [esp + 16]
+    xor ecx, ecx
+    cpuid
+    mov [edi], eax
+    mov [edi + 4], ebx
+    mov [edi + 8], ecx
+    mov [edi + 12], edx
+    pop edi
+    pop ebx
+    ret
+
+; void writeMSR(uint32_t msr, uint32_t low, uint32_t high)
+global writeMSR
+writeMSR:
+    mov ecx, [esp + 4]
+    mov eax, [esp + 8]
+    mov edx, [esp + 12]
+    wrmsr
     ret
\ No newline at end of file
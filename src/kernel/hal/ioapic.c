@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include <debug.h>
+#include <hal/ioapic.h>
+#include <memmgr/vmalloc.h>
+
+/*
+ * The io apic replaces the 8259 pair: each input pin is turned into a
+ * message to a local apic, described by a 64 bit redirection entry. The
+ * registers are reached through an index (IOREGSEL) and a data window
+ * (IOWIN).
+ */
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define IOAPIC_IOREGSEL         0x00
+#define IOAPIC_IOWIN            0x10
+
+#define IOAPIC_REG_VERSION      0x01
+#define IOAPIC_REG_REDIRECTION  0x10    // two registers per pin
+
+typedef enum{
+    IOAPIC_DELIVERY_FIXED       = 0x00000,
+    IOAPIC_DEST_PHYSICAL        = 0x00000,
+    IOAPIC_ACTIVE_LOW           = 0x02000,
+    IOAPIC_LEVEL_TRIGGERED      = 0x08000,
+    IOAPIC_MASKED               = 0x10000,
+}IOAPIC_REDIRECTION_BITS;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+volatile uint8_t* g_ioapic = NULL;
+int g_ioapicPins = 0;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+static uint32_t IOAPIC_read(uint8_t reg)
+{
+    *(volatile uint32_t*)(g_ioapic + IOAPIC_IOREGSEL) = reg;
+    return *(volatile uint32_t*)(g_ioapic + IOAPIC_IOWIN);
+}
+
+static void IOAPIC_write(uint8_t reg, uint32_t value)
+{
+    *(volatile uint32_t*)(g_ioapic + IOAPIC_IOREGSEL) = reg;
+    *(volatile uint32_t*)(g_ioapic + IOAPIC_IOWIN) = value;
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+// every pin starts masked, IOAPIC_route enables the ones in use
+bool IOAPIC_initialize(uint32_t phys)
+{
+    g_ioapic = ioremap(phys, 0x1000, IOREMAP_UNCACHED);
+    if(g_ioapic == NULL)
+    {
+        log_err("ioapic", "failed to map the io apic at 0x%x", phys);
+        return false;
+    }
+
+    g_ioapicPins = ((IOAPIC_read(IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+
+    for(int pin = 0; pin < g_ioapicPins; pin++)
+        IOAPIC_mask(pin);
+
+    log_info("ioapic", "%d pins at 0x%x", g_ioapicPins, phys);
+    return true;
+}
+
+int IOAPIC_getPinCount()
+{
+    return g_ioapicPins;
+}
+
+void IOAPIC_route(int pin, uint8_t vector, uint8_t apic_id, bool active_low, bool level_triggered)
+{
+    if(pin < 0 || pin >= g_ioapicPins)
+        return;
+
+    uint32_t low = IOAPIC_DELIVERY_FIXED | IOAPIC_DEST_PHYSICAL | vector;
+
+    if(active_low)
+        low |= IOAPIC_ACTIVE_LOW;
+
+    if(level_triggered)
+        low |= IOAPIC_LEVEL_TRIGGERED;
+
+    // destination first, the entry is live as soon as the low half is unmasked
+    IOAPIC_write(IOAPIC_REG_REDIRECTION + pin * 2 + 1, (uint32_t)apic_id << 24);
+    IOAPIC_write(IOAPIC_REG_REDIRECTION + pin * 2, low);
+}
+
+void IOAPIC_mask(int pin)
+{
+    if(pin < 0 || pin >= g_ioapicPins)
+        return;
+
+    uint32_t low = IOAPIC_read(IOAPIC_REG_REDIRECTION + pin * 2);
+    IOAPIC_write(IOAPIC_REG_REDIRECTION + pin * 2, low | IOAPIC_MASKED);
+}
+
+void IOAPIC_unMask(int pin)
+{
+    if(pin < 0 || pin >= g_ioapicPins)
+        return;
+
+    uint32_t low = IOAPIC_read(IOAPIC_REG_REDIRECTION + pin * 2);
+    IOAPIC_write(IOAPIC_REG_REDIRECTION + pin * 2, low & ~IOAPIC_MASKED);
+}
@@ -23,18 +23,29 @@
 #include <hal/io.h>
 #include <hal/pic.h>
 #include <hal/pit.h>
+#include <hal/lapic.h>
+#include <hal/ioapic.h>
+#include <hal/smp.h>
+#include <hal/clock.h>
+#include <scheduler/multitask.h>
+#include <trace.h>
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
 //============================================================================
 
 #define PIC_REMAP_OFFSET 0x20
+#define LAPIC_CALIBRATION_MS 50
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DATA
 //============================================================================
 
 IRQHandler g_IRQ_handlers[16];
+irq_stats_t g_IRQ_stats[16];
+
+// the io apic and local apic replace the 8259 once IRQ_enableApic succeeded
+bool g_apicEnabled = false;
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE FUNCTIONS
@@ -42,22 +53,46 @@ IRQHandler g_IRQ_handlers[16];
 
 void IRQ_handler(Registers* regs)
 {
-    int irq = regs->interrupt - PIC_REMAP_OFFSET;
+    // the local apic timer takes the place of the PIT
+    int irq = regs->interrupt == LAPIC_TIMER_VECTOR ? 0 : regs->interrupt - PIC_REMAP_OFFSET;
 
     if (g_IRQ_handlers[irq] != NULL)
     {
+        uint64_t start = clock_cycles();    // the time in ns without a tsc
+        trace(TRACE_IRQ_ENTRY, irq, 0);
+
         // handle IRQ
         g_IRQ_handlers[irq](regs);
+        trace(TRACE_IRQ_EXIT, irq, 0);
+
+        // only the boot cpu counts, the others just get their timer here
+        if(SMP_getCpuIndex() == 0)
+        {
+            uint64_t cycles = clock_cycles() - start;
+            g_IRQ_stats[irq].count++;
+            g_IRQ_stats[irq].total_cycles += cycles;
+            if(cycles > g_IRQ_stats[irq].max_cycles)
+                g_IRQ_stats[irq].max_cycles = cycles;
+        }
     }
     else
     {
-        uint8_t pic_isr = PIC_readInServiceRegister();
-        uint8_t pic_irr = PIC_readIrqRequestRegister();
-        printf("Unhandled IRQ %d  ISR=%x  IRR=%x...\n", irq, pic_isr, pic_irr);
+        if(g_apicEnabled)
+            printf("Unhandled IRQ %d...\n", irq);
+        else
+        {
+            uint8_t pic_isr = PIC_readInServiceRegister();
+            uint8_t pic_irr = PIC_readIrqRequestRegister();
+            printf("Unhandled IRQ %d  ISR=%x  IRR=%x...\n", irq, pic_isr, pic_irr);
+        }
 
         // send EOI
-        PIC_sendEndOfInterrupt(irq);
+        IRQ_sendEndOfInterrupt(irq);
     }
+
+    // the handler may have woken a more important task, switch on the way out
+    if(is_multitaskingEnabled())
+        scheduler_irq_exit();
 }
 
 //============================================================================
@@ -81,7 +116,86 @@ void IRQ_initialize()
     enableInterrupts();
 }
 
+/*
+ * Move the ISA irqs from the 8259 to the io apic, and the tick from the
+ * PIT to the local apic timer. Needs the MP table (SMP_initialize) and
+ * vmalloc. Without an io apic the 8259 and the PIT stay in charge.
+ */
+bool IRQ_enableApic()
+{
+    uint32_t ioapic = SMP_getIoApicAddress();
+
+    if(!LAPIC_isPresent() || ioapic == 0)
+    {
+        log_info("irq", "no io apic, keeping the 8259 PIC");
+        return false;
+    }
+
+    if(!IOAPIC_initialize(ioapic))
+        return false;
+
+    // the PIT still ticks through the 8259 while it measures the local apic timer
+    uint32_t countsPerMs = LAPIC_calibrateTimer(LAPIC_CALIBRATION_MS);
+    if(countsPerMs == 0)
+    {
+        log_warn("irq", "the local apic timer didn't count, keeping the 8259 PIC");
+        return false;
+    }
+
+    disableInterrupts();
+
+    PIC_disable();
+
+    uint8_t apic_id = LAPIC_getId();
+
+    // irq 0 (PIT) is replaced by the local apic timer, irq 2 is the 8259 cascade
+    for(int irq = 1; irq < 16; irq++)
+    {
+        bool active_low, level_triggered;
+        int pin = SMP_getIsaIrqPin(irq, &active_low, &level_triggered);
+
+        if(irq != 2 && pin >= 0)
+            IOAPIC_route(pin, PIC_REMAP_OFFSET + irq, apic_id, active_low, level_triggered);
+    }
+
+    ISR_registerNewHandler(LAPIC_TIMER_VECTOR, IRQ_handler);
+    g_apicEnabled = true;
+
+    PIT_useLapicTimer(countsPerMs);
+
+    enableInterrupts();
+
+    log_info("irq", "io apic enabled, local apic timer at %d counts per ms", countsPerMs);
+    return true;
+}
+
+bool IRQ_isApicEnabled()
+{
+    return g_apicEnabled;
+}
+
+// a single register write with the local apic, one or two port writes with the 8259
+void IRQ_sendEndOfInterrupt(int irq)
+{
+    uint64_t start = clock_cycles();
+
+    if(g_apicEnabled)
+        LAPIC_sendEndOfInterrupt();
+    else
+        PIC_sendEndOfInterrupt(irq);
+
+    if(SMP_getCpuIndex() == 0)
+        g_IRQ_stats[irq].eoi_cycles += clock_cycles() - start;
+}
+
 void IRQ_registerNewHandler(int irq, IRQHandler handler)
 {
     g_IRQ_handlers[irq] = handler;
+}
+
+void IRQ_getStats(int irq, irq_stats_t* stats)
+{
+    uint32_t flags = disableInterruptsSave();
+    *stats = g_IRQ_stats[irq];
+    restoreInterrupts(flags);
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include <debug.h>
+#include <hal/lapic.h>
+#include <hal/isr.h>
+#include <hal/pit.h>
+#include <memmgr/vmalloc.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+// register offsets, every register is 32 bit wide and 16 byte aligned
+#define LAPIC_REG_ID            0x020
+#define LAPIC_REG_TPR           0x080   // task priority
+#define LAPIC_REG_EOI           0x0B0
+#define LAPIC_REG_SVR           0x0F0   // spurious interrupt vector
+#define LAPIC_REG_IRR           0x200   // interrupt request, 8 registers of 32 vectors
+#define LAPIC_REG_ESR           0x280   // error status
+#define LAPIC_REG_ICR_LOW       0x300   // interrupt command
+#define LAPIC_REG_ICR_HIGH      0x310
+#define LAPIC_REG_LVT_TIMER     0x320
+#define LAPIC_REG_TIMER_INITIAL 0x380
+#define LAPIC_REG_TIMER_CURRENT 0x390
+#define LAPIC_REG_TIMER_DIVIDE  0x3E0
+
+#define LAPIC_SVR_ENABLE        0x100
+
+#define LAPIC_LVT_MASKED        0x10000
+#define LAPIC_TIMER_PERIODIC    0x20000
+#define LAPIC_TIMER_DIVIDE_16   0x3
+
+typedef enum{
+    LAPIC_ICR_FIXED             = 0x00000,
+    LAPIC_ICR_INIT              = 0x00500,
+    LAPIC_ICR_STARTUP           = 0x00600,
+
+    LAPIC_ICR_DELIVERY_PENDING  = 0x01000,
+    LAPIC_ICR_ASSERT            = 0x04000,
+
+    LAPIC_ICR_NO_SHORTHAND      = 0x00000,
+    LAPIC_ICR_ALL_BUT_SELF      = 0xC0000,
+}LAPIC_ICR_BITS;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+volatile uint8_t* g_lapic = NULL;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+static uint32_t LAPIC_read(uint32_t reg)
+{
+    return *(volatile uint32_t*)(g_lapic + reg);
+}
+
+static void LAPIC_write(uint32_t reg, uint32_t value)
+{
+    *(volatile uint32_t*)(g_lapic + reg) = value;
+}
+
+static void LAPIC_sendCommand(uint8_t apic_id, uint32_t command)
+{
+    // the previous ipi must be accepted before the command register is reused
+    while(LAPIC_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_DELIVERY_PENDING);
+
+    LAPIC_write(LAPIC_REG_ICR_HIGH, (uint32_t)apic_id << 24);
+    LAPIC_write(LAPIC_REG_ICR_LOW, command);   // writing the low half sends it
+}
+
+// nothing to acknowledge, a spurious interrupt doesn't get an EOI
+static void LAPIC_spuriousHandler(Registers* regs)
+{
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+bool LAPIC_initialize(uint32_t phys)
+{
+    g_lapic = ioremap(phys, 0x1000, IOREMAP_UNCACHED);
+    if(g_lapic == NULL)
+    {
+        log_err("lapic", "failed to map the local apic at 0x%x", phys);
+        return false;
+    }
+
+    ISR_registerNewHandler(LAPIC_SPURIOUS_VECTOR, LAPIC_spuriousHandler);
+    return true;
+}
+
+// called by every cpu for its own local apic, the LVT entries are left as the firmware set them
+void LAPIC_enable()
+{
+    if(g_lapic == NULL)
+        return;
+
+    LAPIC_write(LAPIC_REG_TPR, 0);     // accept every interrupt
+    LAPIC_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+
+    LAPIC_write(LAPIC_REG_ESR, 0);     // the error register is cleared by back to back writes
+    LAPIC_write(LAPIC_REG_ESR, 0);
+}
+
+bool LAPIC_isPresent()
+{
+    return g_lapic != NULL;
+}
+
+uint8_t LAPIC_getId()
+{
+    return LAPIC_read(LAPIC_REG_ID) >> 24;
+}
+
+void LAPIC_sendEndOfInterrupt()
+{
+    LAPIC_write(LAPIC_REG_EOI, 0);
+}
+
+void LAPIC_sendInit(uint8_t apic_id)
+{
+    LAPIC_sendCommand(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT);
+}
+
+// the cpu starts in real mode at page << 12
+void LAPIC_sendStartup(uint8_t apic_id, uint8_t page)
+{
+    LAPIC_sendCommand(apic_id, LAPIC_ICR_STARTUP | LAPIC_ICR_ASSERT | page);
+}
+
+void LAPIC_sendIpi(uint8_t apic_id, uint8_t vector)
+{
+    LAPIC_sendCommand(apic_id, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | LAPIC_ICR_NO_SHORTHAND | vector);
+}
+
+void LAPIC_broadcastIpi(uint8_t vector)
+{
+    LAPIC_sendCommand(0, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | LAPIC_ICR_ALL_BUT_SELF | vector);
+}
+
+// the vector is waiting for this cpu (raised but not delivered yet)
+bool LAPIC_isPending(uint8_t vector)
+{
+    return (LAPIC_read(LAPIC_REG_IRR + (vector / 32) * 0x10) >> (vector % 32)) & 1;
+}
+
+/*
+ * The timer runs at the bus frequency, which the cpu can't tell: count
+ * it down with the interrupt masked during 'ms' PIT ticks.
+ * Returns the timer counts per millisecond (0 if the PIT doesn't tick).
+ */
+uint32_t LAPIC_calibrateTimer(uint32_t ms)
+{
+    LAPIC_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    LAPIC_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+
+    // start on a tick edge
+    uint64_t tick = getTickCount();
+    while(getTickCount() == tick);
+
+    LAPIC_write(LAPIC_REG_TIMER_INITIAL, 0xFFFFFFFF);
+    spin_sleep(ms);
+    uint32_t elapsed = 0xFFFFFFFF - LAPIC_read(LAPIC_REG_TIMER_CURRENT);
+
+    LAPIC_stopTimer();
+
+    return elapsed / ms;
+}
+
+void LAPIC_startTimer(uint32_t count, bool periodic)
+{
+    LAPIC_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    LAPIC_write(LAPIC_REG_LVT_TIMER, (periodic ? LAPIC_TIMER_PERIODIC : 0) | LAPIC_TIMER_VECTOR);
+    LAPIC_write(LAPIC_REG_TIMER_INITIAL, count);   // writing the count starts it
+}
+
+void LAPIC_stopTimer()
+{
+    LAPIC_write(LAPIC_REG_TIMER_INITIAL, 0);
+    LAPIC_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+}
+
+uint32_t LAPIC_getTimerCount()
+{
+    return LAPIC_read(LAPIC_REG_TIMER_CURRENT);
+}
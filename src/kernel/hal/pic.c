@@ -168,12 +168,12 @@ uint16_t PIC_readIrqRequestRegister()
 {
     outb(PIC1_COMMAND_PORT, PIC_CMD_READ_IRR);
     outb(PIC2_COMMAND_PORT, PIC_CMD_READ_IRR);
-    return ((uint16_t)inb(PIC2_COMMAND_PORT)) | (((uint16_t)inb(PIC2_COMMAND_PORT)) << 8);
+    return ((uint16_t)inb(PIC1_COMMAND_PORT)) | (((uint16_t)inb(PIC2_COMMAND_PORT)) << 8);
 }
 
 uint16_t PIC_readInServiceRegister()
 {
     outb(PIC1_COMMAND_PORT, PIC_CMD_READ_ISR);
     outb(PIC2_COMMAND_PORT, PIC_CMD_READ_ISR);
-    return ((uint16_t)inb(PIC2_COMMAND_PORT)) | (((uint16_t)inb(PIC2_COMMAND_PORT)) << 8);
+    return ((uint16_t)inb(PIC1_COMMAND_PORT)) | (((uint16_t)inb(PIC2_COMMAND_PORT)) << 8);
 }
\ No newline at end of file
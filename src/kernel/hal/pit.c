@@ -20,8 +20,12 @@
 #include <hal/pit.h>
 #include <hal/pic.h>
 #include <hal/io.h>
+#include <hal/lapic.h>
+#include <hal/smp.h>
+#include <hal/userinfo.h>
 #include <debug.h>
 #include <scheduler/multitask.h>
+#include <scheduler/timer.h>
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
@@ -31,8 +35,12 @@
 #define COUNTER1_PORT       0X41
 #define COUNTER2_PORT       0X42
 #define CW_PORT             0X43
+#define CONTROL_PORT_B      0X61    // bit 0: channel 2 gate, bit 1: speaker, bit 5: channel 2 output
 
-#define FREQUENCY   1000
+#define FREQUENCY   PIT_TICK_FREQUENCY
+#define PIT_INPUT_FREQUENCY 1193180
+#define COUNT_PER_TICK      (PIT_INPUT_FREQUENCY / FREQUENCY)
+#define MAX_ONESHOT_TICKS   (0xFFFF / COUNT_PER_TICK)   // 16 bit counter: ~54ms
 
 typedef enum{
     PIT_ICW_BINARYCODED_DECIMAL = 0X01,
@@ -55,23 +63,77 @@ typedef enum{
 }PIT_ICW_BYTE;
 
 //============================================================================
-//    INTERFACE FUNCTIONS
+//    IMPLEMENTATION PRIVATE DATA
 //============================================================================
 
-void PIT_initialize()
-{
-    uint32_t count = 1193180 / FREQUENCY;
+uint64_t g_timeSinceBoot = 0;
+bool g_enableMultitask = false;
 
-    log_info("kernel", "Initializing PIT...");
+// dynamic tick (tickless idle)
+bool g_oneShotArmed = false;
+uint32_t g_oneShotTicks = 0;        // ticks covered by the armed one-shot
+uint32_t g_oneShotCount = 0;        // counter value that was loaded
+uint32_t g_countRemainder = 0;      // sub-tick counts left over by an early wake up
+uint64_t g_timerInterrupts = 0;
 
-    // configuring COUNTER 0 for irq0
-    outb(CW_PORT, PIT_ICW_BINARYCODED_DECIMAL | PIT_ICW_MODE2 | PIT_ICW_RL_LSB_MSB | PIT_ICW_COUNTER0);
+// the tick comes from the PIT, or from the local apic timer of every cpu once it is calibrated
+bool g_lapicTimer = false;
+uint32_t g_countPerTick = COUNT_PER_TICK;
+uint32_t g_maxOneShotTicks = MAX_ONESHOT_TICKS;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+void PIT_loadCounter0(uint8_t mode, uint32_t count)
+{
+    // binary counting (the BCD bit is left clear)
+    outb(CW_PORT, mode | PIT_ICW_RL_LSB_MSB | PIT_ICW_COUNTER0);
 
     // sending the least significant byte first
     outb(COUNTER0_PORT, (uint8_t)(count & 0xFF));
 
     // sending the most significant byte
     outb(COUNTER0_PORT, (uint8_t)((count >> 8) & 0xFF));
+}
+
+uint16_t PIT_readCounter0()
+{
+    uint16_t count;
+
+    outb(CW_PORT, PIT_ICW_RL_COUNTER_LATCHED | PIT_ICW_COUNTER0);
+    count = inb(COUNTER0_PORT);
+    count |= ((uint16_t)inb(COUNTER0_PORT)) << 8;
+
+    return count;
+}
+
+void PIT_startPeriodic()
+{
+    if(g_lapicTimer)
+        LAPIC_startTimer(g_countPerTick, true);
+    else
+        PIT_loadCounter0(PIT_ICW_MODE2, COUNT_PER_TICK);
+}
+
+// add elapsed counter counts to the tick count without losing the fractions
+void PIT_accountCounts(uint32_t counts)
+{
+    counts += g_countRemainder;
+    g_timeSinceBoot += counts / g_countPerTick;
+    g_countRemainder = counts % g_countPerTick;
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+void PIT_initialize()
+{
+    log_info("kernel", "Initializing PIT...");
+
+    // configuring COUNTER 0 for irq0
+    PIT_startPeriodic();
 
 
     /*
@@ -80,24 +142,164 @@ void PIT_initialize()
     */
 }
 
-uint64_t g_timeSinceBoot = 0;
-bool g_enableMultitask = false;
-
 void timer(Registers* regs)
 {
-    g_timeSinceBoot++;
+    if(SMP_getCpuIndex() != 0)
+    {
+        // the other cpus only need their time slices, the boot cpu keeps the time
+        IRQ_sendEndOfInterrupt(0);
 
-    // send EOI
-    PIC_sendEndOfInterrupt(0);
+        if(g_enableMultitask)
+            scheduler_tick();
+        return;
+    }
 
-    wakeUp();   // wake up sleeping tasks
+    g_timerInterrupts++;
 
-    if(g_enableMultitask)
+    if(g_oneShotArmed)
     {
-        if(g_timeSinceBoot % 5 == 0)
-            yield();
+        // the whole one-shot period elapsed, go back to periodic ticks
+        g_oneShotArmed = false;
+        PIT_accountCounts(g_oneShotCount);
+        PIT_startPeriodic();
     }
-        
+    else
+        g_timeSinceBoot++;
+
+    USERINFO_updateTime(g_timeSinceBoot);
+
+    // send EOI
+    IRQ_sendEndOfInterrupt(0);
+
+    timer_tick();   // expire kernel timers and wake up sleeping tasks
+
+    if(g_enableMultitask)
+        scheduler_tick();   // time slices are per priority level (MLFQ)
+}
+
+/*
+ * Stop the periodic tick and program a single interrupt 'ticks' from now.
+ * Returns the number of ticks actually armed (the counter is only 16 bit).
+ */
+uint32_t PIT_startOneShot(uint32_t ticks)
+{
+    if(ticks > g_maxOneShotTicks)
+        ticks = g_maxOneShotTicks;
+
+    if(ticks <= 1 || g_oneShotArmed)
+        return 0;   // the periodic tick is as good
+
+    g_oneShotTicks = ticks;
+    g_oneShotCount = ticks * g_countPerTick;
+    g_oneShotArmed = true;
+
+    if(g_lapicTimer)
+        LAPIC_startTimer(g_oneShotCount, false);
+    else
+        PIT_loadCounter0(PIT_ICW_MODE0, g_oneShotCount);    // interrupt on terminal count
+
+    return ticks;
+}
+
+/*
+ * Woken up by another irq before the one-shot fired: account the time
+ * that really elapsed and resume periodic ticks.
+ * Must be called with interrupts disabled.
+ */
+void PIT_stopOneShot()
+{
+    if(!g_oneShotArmed)
+        return;
+
+    // the one-shot already fired, the pending irq0 will do the accounting
+    if(g_lapicTimer ? LAPIC_isPending(LAPIC_TIMER_VECTOR) : (PIC_readIrqRequestRegister() & 0x1))
+        return;
+
+    uint32_t remaining = g_lapicTimer ? LAPIC_getTimerCount() : PIT_readCounter0();
+
+    g_oneShotArmed = false;
+
+    if(remaining > g_oneShotCount)
+        remaining = 0;  // wrapped past the terminal count
+
+    PIT_accountCounts(g_oneShotCount - remaining);
+    USERINFO_updateTime(g_timeSinceBoot);
+    PIT_startPeriodic();
+}
+
+uint32_t PIT_maxOneShotTicks()
+{
+    return g_maxOneShotTicks;
+}
+
+/*
+ * Hand the tick over to the local apic timer of the calling (boot) cpu.
+ * Its 32 bit counter runs at the bus frequency: finer than the 1.19MHz
+ * PIT and one-shots of seconds instead of 54ms.
+ * Must be called with interrupts disabled.
+ */
+void PIT_useLapicTimer(uint32_t countsPerMs)
+{
+    g_lapicTimer = true;
+    g_countPerTick = countsPerMs * 1000 / FREQUENCY;
+    g_maxOneShotTicks = 0xFFFFFFFF / g_countPerTick;
+    g_countRemainder = 0;
+
+    PIT_startPeriodic();
+}
+
+bool PIT_usesLapicTimer()
+{
+    return g_lapicTimer;
+}
+
+uint32_t PIT_getCountPerTick()
+{
+    return g_countPerTick;
+}
+
+// the tick of a secondary cpu, nothing to do if the boot cpu forwards its own
+void PIT_startCpuTick()
+{
+    if(g_lapicTimer)
+        LAPIC_startTimer(g_countPerTick, true);
+}
+
+void PIT_stopCpuTick()
+{
+    if(g_lapicTimer)
+        LAPIC_stopTimer();
+}
+
+uint64_t PIT_getInterruptCount()
+{
+    return g_timerInterrupts;
+}
+
+/*
+ * Time stamp counter cycles during 'ms' milliseconds (at most 54), counted
+ * by channel 2 in one-shot mode and polled: no irq, usable before sti.
+ * Channel 0 and the tick are left alone.
+ */
+uint64_t PIT_measureTsc(uint32_t ms)
+{
+    uint32_t count = PIT_INPUT_FREQUENCY / 1000 * ms;
+    if(count > 0xFFFF)
+        count = 0xFFFF;
+
+    // gate on, speaker off
+    outb(CONTROL_PORT_B, (inb(CONTROL_PORT_B) & ~0x02) | 0x01);
+
+    // mode 0: the output goes high at terminal count
+    outb(CW_PORT, PIT_ICW_MODE0 | PIT_ICW_RL_LSB_MSB | PIT_ICW_COUNTER2);
+    outb(COUNTER2_PORT, (uint8_t)(count & 0xFF));
+    outb(COUNTER2_PORT, (uint8_t)((count >> 8) & 0xFF));    // counting starts here
+
+    uint64_t start = readTSC();
+
+    while((inb(CONTROL_PORT_B) & 0x20) == 0);
+
+    return readTSC() - start;
 }
 
 void enable_multitasking()
@@ -0,0 +1,501 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include <debug.h>
+#include <memory.h>
+#include <hal/smp.h>
+#include <hal/lapic.h>
+#include <hal/gdt.h>
+#include <hal/idt.h>
+#include <hal/fpu.h>
+#include <hal/syscall.h>
+#include <hal/io.h>
+#include <hal/pit.h>
+#include <hal/isr.h>
+#include <scheduler/spinlock.h>
+#include <memmgr/physmem_manager.h>
+#include <memmgr/memory_manager.h>
+#include <memmgr/vmalloc.h>
+
+/*
+ * The cpus are found in the Intel MultiProcessor tables the BIOS leaves in
+ * low memory. The secondary cpus (APs) are woken up with INIT + STARTUP
+ * ipis and run a small real mode trampoline (trampoline.asm) that brings
+ * them to SMP_apEntry in the higher half.
+ */
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define MP_FLOATING_SIGNATURE   0x5F504D5F  // "_MP_"
+#define MP_CONFIG_SIGNATURE     0x504D4350  // "PCMP"
+
+#define MP_ENTRY_PROCESSOR      0
+#define MP_ENTRY_BUS            1
+#define MP_ENTRY_IOAPIC         2
+#define MP_ENTRY_IO_INTERRUPT   3
+#define MP_PROCESSOR_ENABLED    0x01
+#define MP_PROCESSOR_BSP        0x02
+#define MP_IOAPIC_ENABLED       0x01
+#define MP_INTERRUPT_INT        0       // vectored interrupt, the others are NMI/SMI/ExtINT
+
+// polarity and trigger mode of an interrupt entry, 0 means the bus default (ISA: high, edge)
+#define MP_POLARITY_MASK        0x3
+#define MP_POLARITY_LOW         0x3
+#define MP_TRIGGER_MASK         0xC
+#define MP_TRIGGER_LEVEL        0xC
+
+#define ISA_IRQ_COUNT           16
+
+#define IDENTITY_MAP_END        0x400000    // the first 4mb are identity mapped
+#define REAL_MODE_END           0x100000    // the trampoline must be reachable in real mode
+
+#define AP_START_TIMEOUT_MS     100
+
+typedef struct{
+    uint32_t signature;
+    uint32_t config_table;      // physical address of the configuration table
+    uint8_t length;             // in 16 bytes units
+    uint8_t revision;
+    uint8_t checksum;
+    uint8_t features[5];
+}__attribute__((packed)) Mp_floatingPointer;
+
+typedef struct{
+    uint32_t signature;
+    uint16_t length;            // base table length, entries included
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[8];
+    char product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t entry_count;
+    uint32_t lapic_address;
+    uint16_t extended_length;
+    uint8_t extended_checksum;
+    uint8_t reserved;
+}__attribute__((packed)) Mp_configTable;
+
+typedef struct{
+    uint8_t type;
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+}__attribute__((packed)) Mp_processorEntry;   // the other entry types are 8 bytes long
+
+typedef struct{
+    uint8_t type;
+    uint8_t bus_id;
+    char bus_type[6];           // space padded, "ISA   "
+}__attribute__((packed)) Mp_busEntry;
+
+typedef struct{
+    uint8_t type;
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;
+    uint32_t address;
+}__attribute__((packed)) Mp_ioApicEntry;
+
+typedef struct{
+    uint8_t type;
+    uint8_t interrupt_type;
+    uint16_t flags;
+    uint8_t source_bus;
+    uint8_t source_irq;
+    uint8_t ioapic_id;
+    uint8_t ioapic_pin;
+}__attribute__((packed)) Mp_ioInterruptEntry;
+
+typedef struct{
+    int pin;
+    bool active_low;
+    bool level_triggered;
+}Smp_isaIrq;
+
+typedef struct{
+    uint8_t apic_id;
+    volatile bool online;
+}Smp_cpu;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+Smp_cpu g_cpus[SMP_MAX_CPUS];
+int g_cpuCount = 1;                 // the boot cpu is always there
+volatile int g_onlineCount = 1;
+
+uint32_t g_ioApicAddress = 0;       // only the first io apic is used
+Smp_isaIrq g_isaIrqs[ISA_IRQ_COUNT];
+
+SMP_entry g_apEntry = NULL;
+volatile int g_bootingCpu = 0;
+
+// never freed: a cpu that missed its timeout could still run it
+uint8_t* g_trampoline = NULL;
+
+// tlb shootdown: one at a time, every other cpu sets its flag once its tlb is flushed
+spinlock_t g_tlbLock = SPINLOCK_INIT;
+volatile bool g_tlbAck[SMP_MAX_CPUS];
+
+// trampoline.asm
+extern uint8_t ap_trampoline_start[];
+extern uint8_t ap_trampoline_end[];
+extern uint32_t ap_boot_cr3;
+extern uint32_t ap_boot_stack;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+static bool SMP_checksum(void* table, uint32_t length)
+{
+    uint8_t sum = 0;
+
+    for(uint32_t i = 0; i < length; i++)
+        sum += ((uint8_t*)table)[i];
+
+    return sum == 0;
+}
+
+static Mp_floatingPointer* SMP_searchFloatingPointer(uint32_t base, uint32_t length)
+{
+    for(uint32_t addr = base; addr < base + length; addr += 16)
+    {
+        Mp_floatingPointer* mp = (Mp_floatingPointer*)addr;
+
+        if(mp->signature == MP_FLOATING_SIGNATURE && SMP_checksum(mp, mp->length * 16))
+            return mp;
+    }
+
+    return NULL;
+}
+
+// the structure is in the first kb of the EBDA, the last kb of base memory or the BIOS rom
+static Mp_floatingPointer* SMP_findFloatingPointer()
+{
+    Mp_floatingPointer* mp;
+
+    uint32_t ebda = (uint32_t)(*(uint16_t*)0x40E) << 4;
+    if(ebda != 0 && (mp = SMP_searchFloatingPointer(ebda, 0x400)) != NULL)
+        return mp;
+
+    uint32_t base_memory = (uint32_t)(*(uint16_t*)0x413) * 0x400;
+    if((mp = SMP_searchFloatingPointer(base_memory - 0x400, 0x400)) != NULL)
+        return mp;
+
+    return SMP_searchFloatingPointer(0xF0000, 0x10000);
+}
+
+static void SMP_parseInterruptEntry(Mp_ioInterruptEntry* irq, int isa_bus)
+{
+    if(irq->interrupt_type != MP_INTERRUPT_INT || irq->source_bus != isa_bus || irq->source_irq >= ISA_IRQ_COUNT)
+        return;
+
+    g_isaIrqs[irq->source_irq].pin = irq->ioapic_pin;
+    g_isaIrqs[irq->source_irq].active_low = (irq->flags & MP_POLARITY_MASK) == MP_POLARITY_LOW;
+    g_isaIrqs[irq->source_irq].level_triggered = (irq->flags & MP_TRIGGER_MASK) == MP_TRIGGER_LEVEL;
+}
+
+static void SMP_parseConfigTable(Mp_configTable* config)
+{
+    uint8_t* entry = (uint8_t*)(config + 1);
+    uint8_t bsp_id = LAPIC_getId();
+    int isa_bus = -1;
+
+    g_cpus[0].apic_id = bsp_id;
+    g_cpus[0].online = true;
+
+    // without an interrupt entry an ISA irq is wired to the same io apic pin
+    for(int irq = 0; irq < ISA_IRQ_COUNT; irq++)
+    {
+        g_isaIrqs[irq].pin = irq;
+        g_isaIrqs[irq].active_low = false;
+        g_isaIrqs[irq].level_triggered = false;
+    }
+
+    for(int i = 0; i < config->entry_count; i++)
+    {
+        if(*entry == MP_ENTRY_BUS)
+        {
+            Mp_busEntry* bus = (Mp_busEntry*)entry;
+            if(memcmp(bus->bus_type, "ISA", 3) == 0)
+                isa_bus = bus->bus_id;
+        }
+        else if(*entry == MP_ENTRY_IOAPIC)
+        {
+            Mp_ioApicEntry* ioapic = (Mp_ioApicEntry*)entry;
+            if((ioapic->flags & MP_IOAPIC_ENABLED) && g_ioApicAddress == 0)
+                g_ioApicAddress = ioapic->address;
+        }
+        else if(*entry == MP_ENTRY_IO_INTERRUPT)
+            SMP_parseInterruptEntry((Mp_ioInterruptEntry*)entry, isa_bus);     // the bus entries come first
+
+        if(*entry != MP_ENTRY_PROCESSOR)
+        {
+            entry += 8;
+            continue;
+        }
+
+        Mp_processorEntry* cpu = (Mp_processorEntry*)entry;
+        entry += sizeof(Mp_processorEntry);
+
+        if(!(cpu->flags & MP_PROCESSOR_ENABLED) || cpu->apic_id == bsp_id)
+            continue;
+
+        if(g_cpuCount == SMP_MAX_CPUS)
+        {
+            log_warn("smp", "only %d cpus are supported", SMP_MAX_CPUS);
+            break;
+        }
+
+        g_cpus[g_cpuCount].apic_id = cpu->apic_id;
+        g_cpus[g_cpuCount].online = false;
+        g_cpuCount++;
+    }
+}
+
+static void SMP_tlbHandler(Registers* regs)
+{
+    switchPDBR(getPDBR());     // reloading cr3 flushes every non global entry
+    g_tlbAck[SMP_getCpuIndex()] = true;
+    LAPIC_sendEndOfInterrupt();
+}
+
+// first C code of a secondary cpu, on its boot stack with the kernel page directory
+void SMP_apEntry()
+{
+    int cpu = g_bootingCpu;
+
+    GDT_loadCpu(cpu);   // the task register also gives SMP_getCpuIndex its answer
+    IDT_load();
+    LAPIC_enable();
+    FPU_initialize();
+    SYSCALL_initializeCpu(cpu);
+
+    g_onlineCount++;
+    g_cpus[cpu].online = true;     // the boot cpu waits for this one before starting the next
+
+    g_apEntry(cpu);
+
+    // the entry never returns, it becomes the idle task of this cpu
+    for(;;)
+        HLT();
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+// the STARTUP ipi only carries a page number below 1mb
+void SMP_reserveTrampoline()
+{
+    g_trampoline = PHYSMEM_allocBlockBelow(REAL_MODE_END);
+    if(g_trampoline == NULL)
+        log_err("smp", "no low memory page for the trampoline");
+}
+
+void SMP_initialize()
+{
+    log_info("kernel", "Looking for other cpus...");
+
+    g_cpus[0].online = true;
+
+    Mp_floatingPointer* mp = SMP_findFloatingPointer();
+    if(mp == NULL || mp->config_table == 0)
+    {
+        log_warn("smp", "no MP table, running on the boot cpu only");
+        return;
+    }
+
+    if(mp->config_table + sizeof(Mp_configTable) > IDENTITY_MAP_END)
+    {
+        log_warn("smp", "MP configuration table out of reach (0x%x)", mp->config_table);
+        return;
+    }
+
+    Mp_configTable* config = (Mp_configTable*)mp->config_table;
+    if(config->signature != MP_CONFIG_SIGNATURE || !SMP_checksum(config, config->length))
+    {
+        log_warn("smp", "invalid MP configuration table");
+        return;
+    }
+
+    if(!LAPIC_initialize(config->lapic_address != 0 ? config->lapic_address : LAPIC_DEFAULT_ADDRESS))
+        return;
+
+    LAPIC_enable();
+    SMP_parseConfigTable(config);
+
+    ISR_registerNewHandler(IPI_TLB_VECTOR, SMP_tlbHandler);
+
+    log_info("smp", "%d cpu(s) found", g_cpuCount);
+}
+
+// boot the secondary cpus one at a time, each one calls entry(cpu) once it is up
+void SMP_startCpus(SMP_entry entry)
+{
+    if(g_cpuCount == 1 || g_trampoline == NULL)
+        return;
+
+    memcpy(g_trampoline, ap_trampoline_start, ap_trampoline_end - ap_trampoline_start);
+
+    g_apEntry = entry;
+    ap_boot_cr3 = (uint32_t)getPDBR();
+
+    for(int cpu = 1; cpu < g_cpuCount; cpu++)
+    {
+        void* stack = vmalloc(SMP_AP_STACK_SIZE);
+        if(stack == NULL)
+        {
+            log_err("smp", "no memory for the boot stack of cpu %d", cpu);
+            break;
+        }
+
+        ap_boot_stack = (uint32_t)stack + SMP_AP_STACK_SIZE;
+        g_bootingCpu = cpu;
+
+        // INIT, wait 10ms, then STARTUP twice as the MP specification asks
+        LAPIC_sendInit(g_cpus[cpu].apic_id);
+        spin_sleep(10);
+
+        for(int i = 0; i < 2 && !g_cpus[cpu].online; i++)
+        {
+            LAPIC_sendStartup(g_cpus[cpu].apic_id, (uint32_t)g_trampoline >> 12);
+            spin_sleep(1);
+        }
+
+        uint64_t timeout = getTickCount() + AP_START_TIMEOUT_MS;
+        while(!g_cpus[cpu].online && getTickCount() < timeout);
+
+        if(!g_cpus[cpu].online)
+        {
+            // park it in wait-for-STARTUP before the boot data is reused for the next cpu,
+            // its stack is not freed in case it was already running on it
+            LAPIC_sendInit(g_cpus[cpu].apic_id);
+            spin_sleep(10);
+            log_err("smp", "cpu %d (apic %d) didn't start", cpu, g_cpus[cpu].apic_id);
+        }
+    }
+
+    log_info("smp", "%d cpu(s) online", g_onlineCount);
+}
+
+int SMP_getCpuCount()
+{
+    return g_cpuCount;
+}
+
+int SMP_getOnlineCount()
+{
+    return g_onlineCount;
+}
+
+bool SMP_isCpuOnline(int cpu)
+{
+    return cpu >= 0 && cpu < g_cpuCount && g_cpus[cpu].online;
+}
+
+// every cpu has its own task state segment, the loaded one tells which cpu we are
+int SMP_getCpuIndex()
+{
+    uint16_t selector = readTaskRegister();
+
+    // no task register yet: early boot on the boot cpu
+    return selector == 0 ? 0 : (selector >> 3) - GDT_TSS_ENTRY;
+}
+
+void SMP_sendIpi(int cpu, uint8_t vector)
+{
+    if(!SMP_isCpuOnline(cpu) || !LAPIC_isPresent())
+        return;
+
+    LAPIC_sendIpi(g_cpus[cpu].apic_id, vector);
+}
+
+// every online cpu but the calling one
+void SMP_broadcastIpi(uint8_t vector)
+{
+    if(g_onlineCount <= 1)
+        return;
+
+    LAPIC_broadcastIpi(vector);
+}
+
+/*
+ * Kernel mappings are shared by every cpu: after an unmap the others must
+ * drop their cached translation before the range can be reused. The
+ * caller must not hold any spinlock, the other cpus may be spinning on it
+ * with interrupts disabled and never answer.
+ */
+void SMP_shootdownTlb()
+{
+    if(g_onlineCount <= 1)
+        return;
+
+    uint32_t flags = disableInterruptsSave();
+
+    // wait with interrupts enabled, the cpu doing a shootdown might be waiting for us
+    while(!spin_trylock(&g_tlbLock))
+    {
+        restoreInterrupts(flags);
+        cpuRelax();
+        flags = disableInterruptsSave();
+    }
+
+    int self = SMP_getCpuIndex();
+
+    for(int cpu = 0; cpu < g_cpuCount; cpu++)
+        g_tlbAck[cpu] = (cpu == self || !g_cpus[cpu].online);
+
+    LAPIC_broadcastIpi(IPI_TLB_VECTOR);
+
+    for(int cpu = 0; cpu < g_cpuCount; cpu++)
+    {
+        while(!g_tlbAck[cpu])
+            cpuRelax();
+    }
+
+    spin_unlock(&g_tlbLock);
+    restoreInterrupts(flags);
+}
+
+// physical address of the io apic, 0 if the MP table doesn't list one
+uint32_t SMP_getIoApicAddress()
+{
+    return g_ioApicAddress;
+}
+
+// io apic pin an ISA irq is wired to, with its polarity and trigger mode
+int SMP_getIsaIrqPin(int irq, bool* active_low, bool* level_triggered)
+{
+    if(irq < 0 || irq >= ISA_IRQ_COUNT || g_ioApicAddress == 0)
+        return -1;
+
+    *active_low = g_isaIrqs[irq].active_low;
+    *level_triggered = g_isaIrqs[irq].level_triggered;
+    return g_isaIrqs[irq].pin;
+}
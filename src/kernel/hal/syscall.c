@@ -18,24 +18,520 @@
 */
 
 #include <debug.h>
-#include <stdio.h>
+#include <hal/io.h>
 #include <hal/isr.h>
+#include <hal/gdt.h>
+#include <hal/smp.h>
+#include <hal/syscall.h>
+#include <memmgr/physmem_manager.h>
+#include <memmgr/virtmem_manager.h>
+#include <memmgr/vma.h>
+#include <scheduler/multitask.h>
+#include <scheduler/futex.h>
+#include <scheduler/ioring.h>
+#include <vfs/vfs.h>
+#include <memory.h>
+#include <trace.h>
 
-void SYSCALL_handler(Registers* regs)
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define CPUID_SEP               (1 << 11)   // sysenter/sysexit
+
+#define MSR_SYSENTER_CS         0x174
+#define MSR_SYSENTER_ESP        0x175
+#define MSR_SYSENTER_EIP        0x176
+
+// kernel code, sysexit derives the user code (0x1B) and data (0x23) selectors from it
+#define SYSENTER_CS             0x08
+
+#define USER_FD_STDOUT          1
+#define USER_FD_STDERR          2
+#define USER_FD_FIRST_FILE      3   // fd of files[0]
+
+#define PRINT_MAX_LENGTH        4096
+
+#define PAGE_SIZE               0x1000
+#define PAGE_ALIGN_UP(addr)     (((addr) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+
+#define UNMAP_BATCH             32  // frames held back per tlb shootdown
+
+typedef uint32_t (*syscall_fn_t)(uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
+typedef struct syscall_entry
 {
-    switch (regs->eax)
+    syscall_fn_t fn;
+    const char* name;
+}syscall_entry_t;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+bool g_sysenter = false;
+
+// sysenter.asm
+void sysenter_entry();
+
+// per cpu so the dispatch path never shares a cache line, summed by SYSCALL_getStats
+uint32_t g_syscallCounts[SMP_MAX_CPUS][SYSCALL_COUNT];
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+// threads use the files and memory of their process
+static process_t* current_owner()
+{
+    process_t* proc = get_current_process();
+    return proc->leader != NULL ? proc->leader : proc;
+}
+
+// demand paged areas are loaded first, then the mapping is checked
+static bool user_range_ok(const void* addr, size_t size, bool write)
+{
+    VMA_populate(addr, size, write);
+    return VIRTMEM_isUserRange(addr, size, write);
+}
+
+// length of a user string, checked one page at a time
+static int user_strlen(const char* str, size_t max_length)
+{
+    for(size_t i = 0; i < max_length; i++)
     {
-    case 1:
-        printf("%s", (uint8_t*)regs->ebx);
-        break;
-    
+        if((i == 0 || ((uint32_t)(str + i) & (PAGE_SIZE - 1)) == 0) && !user_range_ok(str + i, 1, false))
+            return SYSCALL_EFAULT;
+
+        if(str[i] == '\0')
+            return i;
+    }
+
+    return VFS_EINVAL;  // too long
+}
+
+// vfs descriptor behind a user fd
+static int get_vfs_fd(process_t* owner, uint32_t fd)
+{
+    if(fd == USER_FD_STDOUT)
+        return VFS_FD_STDOUT;
+
+    if(fd == USER_FD_STDERR)
+        return VFS_FD_STDERR;
+
+    if(fd < USER_FD_FIRST_FILE || fd >= USER_FD_FIRST_FILE + PROCESS_MAX_FILES)
+        return VFS_EBADF;
+
+    return owner->files[fd - USER_FD_FIRST_FILE];
+}
+
+/*
+ * Give back the pages [start, end) of the current address space. The ioring
+ * worker shares it and may be running on another cpu: a frame only goes back
+ * to the allocator once no tlb can still reach it.
+ */
+static void unmap_user_pages(uint32_t start, uint32_t end)
+{
+    void* frames[UNMAP_BATCH];
+    uint32_t page = start;
+
+    while(page < end)
+    {
+        int count = 0;
+
+        for(; page < end && count < UNMAP_BATCH; page += PAGE_SIZE)
+        {
+            void* frame = VIRTMEM_unMapPhysPage((void*)page);
+            if(frame != NULL)
+                frames[count++] = frame;    // the heap is demand paged, holes are not mapped
+        }
+
+        if(count == 0)
+            continue;
+
+        SMP_shootdownTlb();
+
+        for(int i = 0; i < count; i++)
+            PHYSMEM_freeBlock(frames[i]);
+    }
+}
+
+// map zeroed user pages in [start, end), nothing stays mapped on failure
+static bool map_user_pages(uint32_t start, uint32_t end)
+{
+    for(uint32_t page = start; page < end; page += PAGE_SIZE)
+    {
+        if(!VIRTMEM_mapPage((void*)page, false))
+        {
+            unmap_user_pages(start, page);
+            return false;
+        }
+
+        memset((void*)page, 0, PAGE_SIZE);  // the frame may hold another process' data
+    }
+
+    return true;
+}
+
+//============================================================================
+//    SYSCALLS
+//============================================================================
+
+static uint32_t sys_null(uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    return 0;
+}
+
+static uint32_t sys_print(uint32_t str, uint32_t arg2, uint32_t arg3)
+{
+    vma_space_t* space = &current_owner()->vmas;
+    uint32_t ret;
+
+    VMA_hold(space);
+
+    int length = user_strlen((const char*)str, PRINT_MAX_LENGTH);
+    ret = length < 0 ? (uint32_t)length : VFS_write(VFS_FD_STDOUT, (const void*)str, length);
+
+    VMA_unhold(space);
+    return ret;
+}
+
+static uint32_t sys_exit(uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    terminate_task();
+    return 0;
+}
+
+static uint32_t sys_open(uint32_t path, uint32_t mode, uint32_t arg3)
+{
+    char kernel_path[VFS_MAX_PATH_LENGTH];
+    vma_space_t* space = &current_owner()->vmas;
+
+    if(mode != VFS_O_RDONLY && mode != VFS_O_WRONLY && mode != VFS_O_RDWR)
+        return VFS_EINVAL;
+
+    VMA_hold(space);
+
+    int length = user_strlen((const char*)path, VFS_MAX_PATH_LENGTH);
+
+    // copied: the user may change it while the vfs walks it
+    if(length >= 0)
+        memcpy(kernel_path, (const void*)path, length + 1);
+
+    VMA_unhold(space);
+
+    if(length < 0)
+        return length;
+
+    fd_t vfs_fd = VFS_open(kernel_path, mode);
+    if(vfs_fd < 0)
+        return vfs_fd;
+
+    process_t* owner = current_owner();
+    int fd = VFS_ENFILE;
+
+    lock_sheduler();
+
+    for(int i = 0; i < PROCESS_MAX_FILES; i++)
+    {
+        if(owner->files[i] == VFS_EBADF)
+        {
+            owner->files[i] = vfs_fd;
+            fd = USER_FD_FIRST_FILE + i;
+            break;
+        }
+    }
+
+    unlock_sheduler();
+
+    if(fd < 0)
+        VFS_close(vfs_fd);
+
+    return fd;
+}
+
+static uint32_t sys_read(uint32_t fd, uint32_t buffer, uint32_t size)
+{
+    process_t* owner = current_owner();
+    uint32_t ret;
+
+    int vfs_fd = get_vfs_fd(owner, fd);
+    if(vfs_fd == VFS_FD_STDOUT || vfs_fd == VFS_FD_STDERR)
+        return VFS_EBADF;   // no keyboard input yet
+
+    // a brk shrink (ioring worker or process) can't unmap the buffer during the copy
+    VMA_hold(&owner->vmas);
+
+    if(!user_range_ok((void*)buffer, size, true))
+        ret = SYSCALL_EFAULT;
+    else
+        ret = VFS_read(vfs_fd, (void*)buffer, size);
+
+    VMA_unhold(&owner->vmas);
+    return ret;
+}
+
+static uint32_t sys_write(uint32_t fd, uint32_t buffer, uint32_t size)
+{
+    process_t* owner = current_owner();
+    uint32_t ret;
+
+    int vfs_fd = get_vfs_fd(owner, fd);
+    if(vfs_fd == VFS_EBADF)
+        return VFS_EBADF;
+
+    VMA_hold(&owner->vmas);
+
+    if(!user_range_ok((void*)buffer, size, false))
+        ret = SYSCALL_EFAULT;
+    else
+        ret = VFS_write(vfs_fd, (const void*)buffer, size);
+
+    VMA_unhold(&owner->vmas);
+    return ret;
+}
+
+static uint32_t sys_close(uint32_t fd, uint32_t arg2, uint32_t arg3)
+{
+    if(fd < USER_FD_FIRST_FILE || fd >= USER_FD_FIRST_FILE + PROCESS_MAX_FILES)
+        return VFS_EBADF;
+
+    process_t* owner = current_owner();
+
+    lock_sheduler();
+
+    int vfs_fd = owner->files[fd - USER_FD_FIRST_FILE];
+    owner->files[fd - USER_FD_FIRST_FILE] = VFS_EBADF;
+
+    unlock_sheduler();
+
+    if(vfs_fd == VFS_EBADF)
+        return VFS_EBADF;
+
+    return VFS_close(vfs_fd);
+}
+
+static uint32_t sys_lseek(uint32_t fd, uint32_t offset, uint32_t whence)
+{
+    int vfs_fd = get_vfs_fd(current_owner(), fd);
+    if(vfs_fd == VFS_FD_STDOUT || vfs_fd == VFS_FD_STDERR)
+        return VFS_EBADF;
+
+    return VFS_lseek(vfs_fd, (int32_t)offset, whence);
+}
+
+/*
+ * Like the linux syscall: returns the new end of the heap, or the unchanged
+ * one on failure. The heap is a demand paged area, growing it maps nothing.
+ */
+static uint32_t sys_brk(uint32_t end, uint32_t arg2, uint32_t arg3)
+{
+    process_t* owner = current_owner();
+
+    if(end < USER_HEAP_START || end > USER_MMAP_START)
+        return owner->brk;
+
+    uint32_t old_top = PAGE_ALIGN_UP(owner->brk);
+    uint32_t new_top = PAGE_ALIGN_UP(end);
+
+    // no syscall may be copying from or to the pages that go away
+    if(new_top < old_top)
+        VMA_beginShrink(&owner->vmas);
+
+    if(new_top != old_top && !VMA_resize(&owner->vmas, USER_HEAP_START, new_top, VMA_READ | VMA_WRITE))
+    {
+        if(new_top < old_top)
+            VMA_endShrink(&owner->vmas);
+
+        return owner->brk;
+    }
+
+    if(new_top < old_top)
+    {
+        unmap_user_pages(new_top, old_top);
+        VMA_endShrink(&owner->vmas);
+    }
+
+    owner->brk = end;
+    return end;
+}
+
+// anonymous memory only, it stays mapped until the process exits
+static uint32_t sys_mmap(uint32_t length, uint32_t arg2, uint32_t arg3)
+{
+    process_t* owner = current_owner();
+
+    if(length == 0)
+        return VFS_EINVAL;
+
+    length = PAGE_ALIGN_UP(length);
+    uint32_t start = owner->mmap_next;
+
+    if(length == 0 || length > USER_MMAP_END - start)
+        return SYSCALL_ENOMEM;
+
+    if(!map_user_pages(start, start + length))
+        return SYSCALL_ENOMEM;
+
+    owner->mmap_next = start + length;
+    return start;
+}
+
+static uint32_t sys_yield(uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    yield();
+    return 0;
+}
+
+static uint32_t sys_sleep(uint32_t ms, uint32_t arg2, uint32_t arg3)
+{
+    sleep(ms);
+    return 0;
+}
+
+static uint32_t sys_getpid(uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    return current_owner()->id;
+}
+
+// the word must be aligned: it can't straddle two pages
+static bool futex_address_ok(uint32_t addr)
+{
+    return (addr & 3) == 0 && user_range_ok((void*)addr, sizeof(uint32_t), false);
+}
+
+static uint32_t sys_futex_wait(uint32_t addr, uint32_t val, uint32_t timeout_ms)
+{
+    if(!futex_address_ok(addr))
+        return SYSCALL_EFAULT;
+
+    switch (futex_wait((uint32_t*)addr, val, timeout_ms))
+    {
+    case FUTEX_EAGAIN:
+        return SYSCALL_EAGAIN;
+
+    case FUTEX_ETIMEDOUT:
+        return SYSCALL_ETIMEDOUT;
+
     default:
-        break;
+        return 0;
     }
 }
 
+static uint32_t sys_futex_wake(uint32_t addr, uint32_t count, uint32_t arg3)
+{
+    if(!futex_address_ok(addr))
+        return SYSCALL_EFAULT;
+
+    return futex_wake((uint32_t*)addr, count);
+}
+
+static uint32_t sys_ioring_setup(uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    if(!ioring_setup(current_owner()))
+        return SYSCALL_ENOMEM;
+
+    return IORING_PAGE;
+}
+
+static uint32_t sys_ioring_enter(uint32_t min_complete, uint32_t arg2, uint32_t arg3)
+{
+    int ready = ioring_enter(current_owner(), min_complete);
+    if(ready < 0)
+        return VFS_EINVAL;
+
+    return ready;
+}
+
+// indexed by the syscall number
+static const syscall_entry_t g_syscallTable[SYSCALL_COUNT] = {
+    [SYSCALL_NULL]      = { sys_null,   "null" },
+    [SYSCALL_PRINT]     = { sys_print,  "print" },
+    [SYSCALL_EXIT]      = { sys_exit,   "exit" },
+    [SYSCALL_OPEN]      = { sys_open,   "open" },
+    [SYSCALL_READ]      = { sys_read,   "read" },
+    [SYSCALL_WRITE]     = { sys_write,  "write" },
+    [SYSCALL_CLOSE]     = { sys_close,  "close" },
+    [SYSCALL_LSEEK]     = { sys_lseek,  "lseek" },
+    [SYSCALL_BRK]       = { sys_brk,    "brk" },
+    [SYSCALL_MMAP]      = { sys_mmap,   "mmap" },
+    [SYSCALL_YIELD]     = { sys_yield,  "yield" },
+    [SYSCALL_SLEEP]     = { sys_sleep,  "sleep" },
+    [SYSCALL_GETPID]    = { sys_getpid, "getpid" },
+    [SYSCALL_FUTEX_WAIT] = { sys_futex_wait, "futex_wait" },
+    [SYSCALL_FUTEX_WAKE] = { sys_futex_wake, "futex_wake" },
+    [SYSCALL_IORING_SETUP] = { sys_ioring_setup, "ioring_setup" },
+    [SYSCALL_IORING_ENTER] = { sys_ioring_enter, "ioring_enter" },
+};
+
+// int 0x80: eax = number, ebx/ecx/edx = arguments, the result goes back in eax
+void SYSCALL_handler(Registers* regs)
+{
+    regs->eax = SYSCALL_dispatch(regs->eax, regs->ebx, regs->ecx, regs->edx);
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+// common to int 0x80 (trap gate) and sysenter (interrupts disabled)
+uint32_t SYSCALL_dispatch(uint32_t number, uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    if(number >= SYSCALL_COUNT)
+        return (uint32_t)SYSCALL_ENOSYS;
+
+    disableInterrupts();    // no migration between the cpu index and the increment
+    g_syscallCounts[SMP_getCpuIndex()][number]++;
+
+    // a syscall may block (read, sleep) and is preemptible like any kernel code
+    enableInterrupts();
+
+    trace(TRACE_SYSCALL_ENTRY, number, arg1);
+    uint32_t result = g_syscallTable[number].fn(arg1, arg2, arg3);
+    trace(TRACE_SYSCALL_EXIT, number, result);
+
+    return result;
+}
+
 void SYSCALL_initialize()
 {
     log_info("kernel", "Initializing syscall...");
     ISR_registerNewHandler(0x80, SYSCALL_handler);
-}
\ No newline at end of file
+
+    g_sysenter = (readCpuidFeatures() & CPUID_SEP) != 0;
+    SYSCALL_initializeCpu(0);
+}
+
+// the sysenter MSRs are per cpu, every cpu enters on its own TSS kernel stack slot
+void SYSCALL_initializeCpu(int cpu)
+{
+    if(!g_sysenter)
+        return;
+
+    writeMSR(MSR_SYSENTER_CS, SYSENTER_CS, 0);
+    writeMSR(MSR_SYSENTER_ESP, (uint32_t)TSS_getKernelStackSlot(cpu), 0);
+    writeMSR(MSR_SYSENTER_EIP, (uint32_t)sysenter_entry, 0);
+}
+
+bool SYSCALL_hasSysenter()
+{
+    return g_sysenter;
+}
+
+int SYSCALL_getStats(syscall_stats_t* stats, int max_count)
+{
+    int count = 0;
+
+    for(int number = 0; number < SYSCALL_COUNT && count < max_count; number++)
+    {
+        stats[count].name = g_syscallTable[number].name;
+        stats[count].count = 0;
+
+        for(int cpu = 0; cpu < SMP_MAX_CPUS; cpu++)
+            stats[count].count += g_syscallCounts[cpu][number];
+
+        count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,48 @@
+; Copyright (C) 2025,  Novice
+;
+; This file is part of the Novix software.
+;
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+;
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+;
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+[bits 32]
+
+TSS_ESP0_OFFSET equ 0   ; IA32_SYSENTER_ESP points at the esp0 slot of the cpu's TSS
+
+extern SYSCALL_dispatch
+
+; sysenter: eax = number, ebx/esi/edi = arguments, ecx = user stack, edx = return address
+; The cpu loads cs/ss from IA32_SYSENTER_CS and clears IF, nothing else is saved:
+; only what SYSCALL_dispatch may clobber and what sysexit needs is kept.
+global sysenter_entry
+sysenter_entry:
+    mov esp, [esp + TSS_ESP0_OFFSET]    ; kernel stack of the current task
+
+    push ecx            ; user stack
+    push edx            ; user eip
+
+    push edi            ; arguments
+    push esi
+    push ebx
+    push eax            ; number
+
+    call SYSCALL_dispatch   ; result in eax, ebx/esi/edi/ebp are preserved by cdecl
+    cli                     ; the handler ran with interrupts enabled
+
+    add esp, 16
+    pop edx
+    pop ecx
+
+    sti                 ; takes effect after sysexit, no interrupt on the kernel stack in between
+    sysexit
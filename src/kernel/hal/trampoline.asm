@@ -0,0 +1,99 @@
+; Copyright (C) 2025,  Novice
+;
+; This file is part of the Novix software.
+;
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+;
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+;
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+; Boot code of the secondary cpus. Only the real mode part, up to
+; ap_trampoline_end, is copied to a page below 1mb: a cpu woken up by a
+; STARTUP ipi begins there with cs = page << 8 and ip = 0. Everything it
+; needs after that is reached through its physical address in the
+; kernel image, until paging is enabled with the kernel page directory.
+
+KERNEL_PHYS_OFFSET  equ 0xBFF00000  ; virtual - physical address of the kernel (linker.ld)
+
+extern SMP_apEntry
+
+global ap_trampoline_start
+global ap_trampoline_end
+global ap_boot_cr3
+global ap_boot_stack
+
+section .text
+
+[bits 16]
+ap_trampoline_start:
+    cli
+    cld
+
+    mov ax, cs                  ; the offsets below are relative to the copied page
+    mov ds, ax
+
+    o32 lgdt [ap_gdt_descriptor - ap_trampoline_start]
+
+    mov eax, cr0
+    or al, 1                    ; protected mode
+    mov cr0, eax
+
+    o32 jmp far [ap_protected_jump - ap_trampoline_start]
+
+align 4
+ap_protected_jump:
+    dd ap_protected_mode - KERNEL_PHYS_OFFSET
+    dw 0x08
+
+ap_gdt_descriptor:
+    dw ap_gdt_end - ap_gdt - 1
+    dd ap_gdt - KERNEL_PHYS_OFFSET
+
+ap_trampoline_end:
+
+align 8
+ap_gdt:
+    dq 0                        ; null descriptor
+    dq 0x00CF9A000000FFFF       ; 0x08: flat 32 bit code
+    dq 0x00CF92000000FFFF       ; 0x10: flat 32 bit data
+ap_gdt_end:
+
+[bits 32]
+ap_protected_mode:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    mov eax, [ap_boot_cr3 - KERNEL_PHYS_OFFSET]
+    mov cr3, eax
+
+    ; still running at the physical address, fine: the first 4mb are identity mapped
+    mov eax, cr0
+    or eax, 0x80000000
+    mov cr0, eax
+
+    mov esp, [ap_boot_stack]    ; set by SMP_startCpus for the cpu being started
+
+    mov eax, SMP_apEntry        ; absolute jump to the higher half
+    call eax
+
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+section .data
+ap_boot_cr3:    dd 0
+ap_boot_stack:  dd 0
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <debug.h>
+#include <memory.h>
+#include <hal/io.h>
+#include <hal/clock.h>
+#include <hal/pit.h>
+#include <hal/userinfo.h>
+#include <memmgr/virtmem_manager.h>
+#include <memmgr/vmalloc.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define PAGE_SIZE               0x1000
+#define CALIBRATION_PERIOD      1000    // ticks between two measures of the tsc frequency
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+volatile userinfo_shared_t* g_sharedPage = NULL;    // kernel mapping of the shared frame
+void* g_sharedFrame = NULL;
+
+// tsc frequency, averaged since the first tick seen
+uint64_t g_firstTsc = 0;
+uint64_t g_firstTick = 0;
+uint64_t g_nextCalibration = 0;
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+void USERINFO_initialize()
+{
+    log_info("kernel", "Initializing the user info page...");
+
+    g_sharedPage = vmalloc(PAGE_SIZE);
+    if(g_sharedPage == NULL)
+    {
+        log_err("kernel", "no memory for the user info page!\n");
+        return;
+    }
+
+    memset((void*)g_sharedPage, 0, PAGE_SIZE);
+    g_sharedPage->tick_ms = 1000 / PIT_TICK_FREQUENCY;
+    g_sharedPage->tsc_per_ms = CLOCK_getTscKhz();   // boot calibration, refined every second
+
+    g_sharedFrame = VIRTMEM_getPhysAddr((void*)g_sharedPage);
+}
+
+// in the current address space, before the process enters user mode
+void USERINFO_mapPages(int pid)
+{
+    if(g_sharedFrame == NULL)
+        return;
+
+    // the frame isn't the process' one, clearing the address space must leave it alone
+    VIRTMEM_mapPhysPage((void*)USERINFO_SHARED_PAGE, g_sharedFrame, PTE_PAGE_USER_MODE | PTE_PAGE_SHARED);
+
+    if(!VIRTMEM_mapPage((void*)USERINFO_PROCESS_PAGE, false))
+        return;
+
+    memset((void*)USERINFO_PROCESS_PAGE, 0, PAGE_SIZE);
+    ((userinfo_process_t*)USERINFO_PROCESS_PAGE)->pid = pid;
+
+    VIRTMEM_writeProtectPage((void*)USERINFO_PROCESS_PAGE);
+}
+
+// boot cpu, interrupts disabled: it is the only writer
+void USERINFO_updateTime(uint64_t ticks)
+{
+    if(g_sharedPage == NULL)
+        return;
+
+    // without a time stamp counter tsc_per_ms stays 0: user code then uses the tick alone
+    if(CLOCK_getTscKhz() == 0)
+    {
+        g_sharedPage->sequence++;
+        g_sharedPage->ticks = ticks;
+        g_sharedPage->sequence++;
+        return;
+    }
+
+    uint64_t tsc = readTSC();
+    uint32_t tsc_per_ms = g_sharedPage->tsc_per_ms;
+
+    if(g_firstTsc == 0)
+    {
+        g_firstTsc = tsc;
+        g_firstTick = ticks;
+        g_nextCalibration = ticks + CALIBRATION_PERIOD;
+    }
+    else if(ticks >= g_nextCalibration)
+    {
+        // over the whole uptime: the error of one tick fades away
+        tsc_per_ms = (tsc - g_firstTsc) / ((ticks - g_firstTick) * g_sharedPage->tick_ms);
+        g_nextCalibration = ticks + CALIBRATION_PERIOD;
+    }
+
+    // x86 doesn't reorder stores, volatile keeps the compiler from doing it
+    g_sharedPage->sequence++;
+    g_sharedPage->ticks = ticks;
+    g_sharedPage->tsc_at_tick = tsc;
+    g_sharedPage->tsc_per_ms = tsc_per_ms;
+    g_sharedPage->sequence++;
+}
@@ -19,6 +19,7 @@
 
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
 
 //============================================================================
 //    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
@@ -128,5 +129,7 @@ void KEYBOARD_disable();
 void KEYBOARD_enable();
 void KEYBOARD_discardLastKey();
 KEYCODE KEYBOARD_getLastKey();
+KEYCODE KEYBOARD_waitForKey();
+bool KEYBOARD_hasKey();
 void KEYBOARD_initialize();
 char KEYBOARD_scanToAscii(uint8_t scancode);
\ No newline at end of file
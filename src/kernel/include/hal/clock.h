@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+typedef enum {
+    CLOCK_SOURCE_PIT,   // 1ms ticks, always there
+    CLOCK_SOURCE_TSC,   // time stamp counter calibrated at boot
+}CLOCK_SOURCE;
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void CLOCK_initialize();
+bool CLOCK_setSource(CLOCK_SOURCE source);
+CLOCK_SOURCE CLOCK_getSource();
+bool CLOCK_hasInvariantTsc();
+uint32_t CLOCK_getTscKhz();
+
+uint64_t clock_ns();
+uint64_t clock_cycles();
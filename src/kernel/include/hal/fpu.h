@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define FPU_STATE_SIZE      512     // FXSAVE area
+#define FPU_STATE_ALIGN     16
+#define FPU_TRAP_VECTOR     7       // #NM, device not available: FPU instruction with CR0.TS set
+
+// first aligned byte of a buffer of FPU_STATE_SIZE + FPU_STATE_ALIGN - 1 bytes
+#define FPU_ALIGN_STATE(buffer) ((uint8_t*)(((uint32_t)(buffer) + FPU_STATE_ALIGN - 1) & ~(FPU_STATE_ALIGN - 1)))
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void FPU_initialize();
+bool FPU_hasSse();
+void FPU_initState(uint8_t* state);
+void FPU_save(uint8_t* state);
+void FPU_restore(uint8_t* state);
+
+// fpu.asm
+void __attribute__((cdecl)) FPU_setTaskSwitched();
+void __attribute__((cdecl)) FPU_clearTaskSwitched();
@@ -20,9 +20,17 @@
 #pragma once
 #include <stdint.h>
 
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define GDT_TSS_ENTRY   5   // task state segment of cpu 0, cpu n uses the entry 5 + n
+
 //============================================================================
 //    INTERFACE FUNCTION PROTOTYPES
 //============================================================================
 
 void GDT_initilize();
-void TSS_setKernelStack(uint32_t esp0);
\ No newline at end of file
+void GDT_loadCpu(int cpu);
+void TSS_setKernelStack(uint32_t esp0);
+uint32_t* TSS_getKernelStackSlot(int cpu);
\ No newline at end of file
@@ -44,4 +44,5 @@ typedef enum{
 //============================================================================
 
 void IDT_initilize();
+void IDT_load();
 void IDT_setGate(int interrupt, void* offset, uint8_t attribute);
\ No newline at end of file
@@ -32,5 +32,14 @@ void __attribute__((cdecl)) panic();
 void __attribute__((cdecl)) HLT();
 void __attribute__((cdecl)) enableInterrupts();
 void __attribute__((cdecl)) disableInterrupts();
+void __attribute__((cdecl)) enableInterruptsAndHLT();
+uint64_t __attribute__((cdecl)) readTSC();
+uint16_t __attribute__((cdecl)) readTaskRegister();
+uint32_t __attribute__((cdecl)) disableInterruptsSave();
+void __attribute__((cdecl)) restoreInterrupts(uint32_t flags);
+void __attribute__((cdecl)) cpuRelax();
+uint32_t __attribute__((cdecl)) readCpuidFeatures();
+void __attribute__((cdecl)) readCpuid(uint32_t leaf, uint32_t regs[4]);
+void __attribute__((cdecl)) writeMSR(uint32_t msr, uint32_t low, uint32_t high);
 
 void iowait();
\ No newline at end of file
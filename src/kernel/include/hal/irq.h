@@ -18,6 +18,8 @@
 */
 
 #pragma once
+#include <stdint.h>
+#include <stdbool.h>
 #include <hal/isr.h>
 
 //============================================================================
@@ -26,9 +28,21 @@
 
 typedef void (*IRQHandler) (Registers* regs);
 
+typedef struct irq_stats
+{
+    uint64_t count;
+    uint64_t total_cycles;  // time spent in the handler, measured with the TSC
+    uint64_t max_cycles;
+    uint64_t eoi_cycles;    // part of the total spent acknowledging the controller
+}irq_stats_t;
+
 //============================================================================
 //    INTERFACE FUNCTION PROTOTYPES
 //============================================================================
 
 void IRQ_initialize();
-void IRQ_registerNewHandler(int irq, IRQHandler handler);
\ No newline at end of file
+bool IRQ_enableApic();
+bool IRQ_isApicEnabled();
+void IRQ_sendEndOfInterrupt(int irq);
+void IRQ_registerNewHandler(int irq, IRQHandler handler);
+void IRQ_getStats(int irq, irq_stats_t* stats);
\ No newline at end of file
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define LAPIC_DEFAULT_ADDRESS   0xFEE00000
+#define LAPIC_SPURIOUS_VECTOR   0xFF
+#define LAPIC_TIMER_VECTOR      0xE0
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+bool LAPIC_initialize(uint32_t phys);
+void LAPIC_enable();
+bool LAPIC_isPresent();
+uint8_t LAPIC_getId();
+void LAPIC_sendEndOfInterrupt();
+void LAPIC_sendInit(uint8_t apic_id);
+void LAPIC_sendStartup(uint8_t apic_id, uint8_t page);
+void LAPIC_sendIpi(uint8_t apic_id, uint8_t vector);
+void LAPIC_broadcastIpi(uint8_t vector);
+bool LAPIC_isPending(uint8_t vector);
+uint32_t LAPIC_calibrateTimer(uint32_t ms);
+void LAPIC_startTimer(uint32_t count, bool periodic);
+void LAPIC_stopTimer();
+uint32_t LAPIC_getTimerCount();
@@ -22,6 +22,12 @@
 #include <stdint.h>
 #include <hal/irq.h>
 
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define PIT_TICK_FREQUENCY  1000    // ticks per second, getTickCount() counts ms
+
 //============================================================================
 //    INTERFACE FUNCTION PROTOTYPES
 //============================================================================
@@ -31,4 +37,15 @@ void timer(Registers* regs);
 void enable_multitasking();
 bool is_multitaskingEnabled();
 uint64_t getTickCount();
+
+uint32_t PIT_startOneShot(uint32_t ticks);
+void PIT_stopOneShot();
+uint32_t PIT_maxOneShotTicks();
+void PIT_useLapicTimer(uint32_t countsPerMs);
+bool PIT_usesLapicTimer();
+uint32_t PIT_getCountPerTick();
+void PIT_startCpuTick();
+void PIT_stopCpuTick();
+uint64_t PIT_getInterruptCount();
+uint64_t PIT_measureTsc(uint32_t ms);
 void spin_sleep(uint32_t ms);
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define SMP_MAX_CPUS            8
+#define SMP_AP_STACK_SIZE       0x2000      // boot stack of a secondary cpu, it becomes its idle task stack
+
+// inter processor interrupts
+#define IPI_RESCHEDULE_VECTOR   0xF0
+#define IPI_TICK_VECTOR         0xF1
+#define IPI_TLB_VECTOR          0xF2
+
+typedef void (*SMP_entry) (int cpu);
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void SMP_reserveTrampoline();
+void SMP_initialize();
+void SMP_startCpus(SMP_entry entry);
+int SMP_getCpuCount();
+int SMP_getOnlineCount();
+bool SMP_isCpuOnline(int cpu);
+int SMP_getCpuIndex();
+void SMP_sendIpi(int cpu, uint8_t vector);
+void SMP_broadcastIpi(uint8_t vector);
+void SMP_shootdownTlb();
+uint32_t SMP_getIoApicAddress();
+int SMP_getIsaIrqPin(int irq, bool* active_low, bool* level_triggered);
@@ -18,5 +18,64 @@
 */
 
 #pragma once
+#include <stdint.h>
+#include <stdbool.h>
 
-void SYSCALL_initialize();
\ No newline at end of file
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+/*
+ * int 0x80:    eax = number, ebx, ecx, edx = arguments
+ * sysenter:    eax = number, ebx, esi, edi = arguments,
+ *              ecx = user stack and edx = return address (restored by sysexit)
+ * The result is returned in eax, a negative value is an error (vfs_error_t or SYSCALL_ERROR).
+ *
+ * File descriptors: 1 is stdout, 2 is stderr, open returns 3 and above.
+ */
+typedef enum{
+    SYSCALL_NULL    = 0,    // does nothing, measures the round trip
+    SYSCALL_PRINT   = 1,    // string
+    SYSCALL_EXIT    = 2,
+    SYSCALL_OPEN    = 3,    // path, mode (VFS_O_*) -> fd
+    SYSCALL_READ    = 4,    // fd, buffer, size -> bytes read
+    SYSCALL_WRITE   = 5,    // fd, buffer, size -> bytes written
+    SYSCALL_CLOSE   = 6,    // fd
+    SYSCALL_LSEEK   = 7,    // fd, offset, whence (VFS_SEEK_*) -> new position
+    SYSCALL_BRK     = 8,    // new end of the heap, 0 to query -> current end of the heap
+    SYSCALL_MMAP    = 9,    // length -> address of zeroed anonymous pages
+    SYSCALL_YIELD   = 10,
+    SYSCALL_SLEEP   = 11,   // milliseconds
+    SYSCALL_GETPID  = 12,
+    SYSCALL_FUTEX_WAIT  = 13,   // addr, val, timeout in ms (0: none) -> sleeps while *addr == val
+    SYSCALL_FUTEX_WAKE  = 14,   // addr, count -> tasks woken
+    SYSCALL_IORING_SETUP = 15,  // -> address of the ring page (scheduler/ioring.h)
+    SYSCALL_IORING_ENTER = 16,  // min_complete -> completions ready to reap
+
+    SYSCALL_COUNT
+}SYSCALL_NUMBER;
+
+// after the vfs codes (vfs_error_t)
+typedef enum{
+    SYSCALL_ENOSYS  = -13,  // unknown syscall number
+    SYSCALL_EFAULT  = -14,  // bad user pointer
+    SYSCALL_ENOMEM  = -15,  // out of memory or address space
+    SYSCALL_EAGAIN  = -16,  // futex_wait: the value already changed
+    SYSCALL_ETIMEDOUT = -17,
+}SYSCALL_ERROR;
+
+typedef struct syscall_stats
+{
+    const char* name;
+    uint64_t count;         // calls on every cpu
+}syscall_stats_t;
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void SYSCALL_initialize();
+void SYSCALL_initializeCpu(int cpu);
+bool SYSCALL_hasSysenter();
+uint32_t SYSCALL_dispatch(uint32_t number, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+int SYSCALL_getStats(syscall_stats_t* stats, int max_count);
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+// read-only pages at the top of every user address space (src/user/userinfo.inc)
+#define USERINFO_PROCESS_PAGE   0xBFFFE000  // private: the process
+#define USERINFO_SHARED_PAGE    0xBFFFF000  // same frame for everybody: the time
+
+/*
+ * Written by the boot cpu on each tick. A reader retries while sequence is
+ * odd or changed during its read (seqlock), no syscall and no lock.
+ * Time in ms: ticks * tick_ms + (rdtsc - tsc_at_tick) / tsc_per_ms
+ * The offsets are part of the user ABI.
+ */
+typedef struct userinfo_shared
+{
+    uint32_t sequence;      // 0
+    uint32_t tick_ms;       // 4: length of a tick
+    uint64_t ticks;         // 8: getTickCount()
+    uint64_t tsc_at_tick;   // 16: time stamp counter when ticks was updated
+    uint32_t tsc_per_ms;    // 24: 0 without a time stamp counter
+}__attribute__((packed)) userinfo_shared_t;
+
+typedef struct userinfo_process
+{
+    int32_t pid;            // 0
+}__attribute__((packed)) userinfo_process_t;
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void USERINFO_initialize();
+void USERINFO_mapPages(int pid);
+void USERINFO_updateTime(uint64_t ticks);
@@ -29,4 +29,5 @@
 void __attribute__((cdecl)) enablePaging();
 void __attribute__((cdecl)) flushTLB(uint32_t* virtual_addr);
 void* __attribute__((cdecl)) getPDBR();
+uint32_t __attribute__((cdecl)) getPageFaultAddress();
 void __attribute__((cdecl)) switchPDBR(uint32_t* physical_addr);
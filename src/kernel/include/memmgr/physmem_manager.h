@@ -39,6 +39,7 @@ typedef struct physmem_info
 void PHYSMEM_initialize(Boot_info* info);
 void PHYSMEM_freeBlock(void* ptr);
 void* PHYSMEM_AllocBlock();
+void* PHYSMEM_allocBlockBelow(uint32_t limit);
 void* PHYSMEM_AllocBlocks(uint8_t blocks);
 void PHYSMEM_freeBlocks(void* ptr, uint8_t size);
 void PHYSMEM_getMemoryInfo(physmem_info_t* info);
\ No newline at end of file
@@ -20,6 +20,7 @@
 
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 //============================================================================
@@ -34,6 +35,9 @@ typedef enum {
     PTE_PAGE_WRITE          = 0X2,
     PTE_PAGE_KERNEL_MODE    = 0X0,
     PTE_PAGE_USER_MODE      = 0X4,
+    PTE_PAGE_PWT            = 0X8,
+    PTE_PAGE_PCD            = 0X10,
+    PTE_PAGE_SHARED         = 0X200,    // available bit: frame not owned by the address space
 }PTE_FLAGS;
 
 typedef enum {
@@ -53,15 +57,22 @@ typedef enum {
 
 void VIRTMEM_initialize();
 uint32_t* VIRTMEM_getPhysAddr(void* virt);
+bool VIRTMEM_isUserRange(const void* virt, size_t size, bool write);
 
 bool VIRTMEM_mapTable(void* virt, bool kernel_mode);
 bool VIRTMEM_unMapTable(void* virt);
 
 bool VIRTMEM_mapPage (void* virt, bool kernel_mode);
 bool VIRTMEM_unMapPage (void* virt);
+bool VIRTMEM_writeProtectPage(void* virt);
+
+bool VIRTMEM_mapPhysPage(void* virt, void* phys, uint32_t flags);
+void* VIRTMEM_unMapPhysPage(void* virt);
 
 void VIRTMEM_freePage(PTE* entry);
 bool VIRTMEM_allocPage(PTE* entry, uint32_t flags);
 
 uint32_t* VIRTMEM_createAddressSpace();
-void VIRTMEM_destroyAddressSpace(PDE* page_directory);
\ No newline at end of file
+void VIRTMEM_destroyAddressSpace(PDE* page_directory);
+void VIRTMEM_clearAddressSpace(PDE* page_directory);
+void VIRTMEM_refreshKernelSpace(PDE* page_directory);
\ No newline at end of file
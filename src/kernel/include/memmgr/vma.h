@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define VMA_MAX_AREAS       8       // per process: program segments and the stack
+
+typedef enum {
+    VMA_READ    = 0x1,
+    VMA_WRITE   = 0x2,
+    VMA_EXEC    = 0x4,
+}VMA_FLAGS;
+
+/*
+ * Part of a user address space that is paged in on the first access.
+ * The first file_size bytes come from the file, the rest is zero filled.
+ */
+typedef struct vma
+{
+    uint32_t start;         // page aligned
+    uint32_t end;           // page aligned, excluded
+    uint32_t flags;         // VMA_FLAGS
+    int fd;                 // vfs descriptor of the file, -1 for anonymous memory
+    uint32_t file_offset;   // file position of start
+    uint32_t file_size;     // bytes of the area backed by the file
+}vma_t;
+
+typedef struct vma_space
+{
+    vma_t areas[VMA_MAX_AREAS];
+    int count;
+    uint32_t holders;       // syscalls between their user range check and the end of the copy
+    bool shrinking;         // pages are being taken away, new holders wait
+}vma_space_t;
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void VMA_initialize();
+void VMA_initSpace(vma_space_t* space);
+bool VMA_add(vma_space_t* space, uint32_t start, uint32_t end, uint32_t flags, int fd, uint32_t file_offset, uint32_t file_size);
+bool VMA_resize(vma_space_t* space, uint32_t start, uint32_t end, uint32_t flags);
+bool VMA_populate(const void* virt, size_t size, bool write);
+void VMA_hold(vma_space_t* space);
+void VMA_unhold(vma_space_t* space);
+void VMA_beginShrink(vma_space_t* space);
+void VMA_endShrink(vma_space_t* space);
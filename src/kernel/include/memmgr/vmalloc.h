@@ -17,7 +17,19 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#pragma once
 #include <stddef.h>
+#include <stdint.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+typedef enum {
+    IOREMAP_CACHED          = 0,    // write-back, normal memory
+    IOREMAP_WRITE_THROUGH   = 1,    // PWT, e.g. a linear framebuffer
+    IOREMAP_UNCACHED        = 2,    // PCD | PWT, device registers
+}IOREMAP_CACHE_MODE;
 
 //============================================================================
 //    INTERFACE FUNCTION PROTOTYPES
@@ -25,4 +37,10 @@
 
 void VMALLOC_initialize();
 void* vmalloc(size_t size);
-void vfree(void* ptr);
\ No newline at end of file
+void vfree(void* ptr);
+
+void* vmap(void** frames, size_t count, uint32_t flags);
+void vunmap(void* addr);
+
+void* ioremap(uint32_t phys, size_t len, IOREMAP_CACHE_MODE cache_mode);
+void iounmap(void* addr);
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <scheduler/multitask.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define ELF_MAGIC           0x464C457F  // "\x7FELF"
+#define ELF_CLASS_32        1
+#define ELF_DATA_LSB        1
+#define ELF_TYPE_EXEC       2
+#define ELF_MACHINE_386     3
+
+#define ELF_PT_LOAD         1
+
+#define ELF_PF_X            0x1
+#define ELF_PF_W            0x2
+#define ELF_PF_R            0x4
+
+typedef struct elf32_header
+{
+    uint32_t magic;
+    uint8_t class;
+    uint8_t data;
+    uint8_t version;
+    uint8_t pad[9];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version2;
+    uint32_t entry;
+    uint32_t phoff;         // program headers
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+}__attribute__((packed)) elf32_header_t;
+
+typedef struct elf32_program_header
+{
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+}__attribute__((packed)) elf32_program_header_t;
+
+typedef enum {
+    ELF_OK          = 0,
+    ELF_NOT_ELF     = -1,   // no ELF magic: a flat binary
+    ELF_INVALID     = -2,   // an ELF this kernel can't run
+}ELF_STATUS;
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+int elf_load(process_t* proc, int fd, uint32_t* entry);
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <scheduler/multitask.h>
+#include <scheduler/waitqueue.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define IORING_PAGE         0xBFFFD000  // user address of the ring page, under the info pages
+#define IORING_ENTRIES      64          // per ring, power of two
+
+#define IORING_SQ_OFFSET    64          // submission entries, after the header
+#define IORING_CQ_OFFSET    (IORING_SQ_OFFSET + IORING_ENTRIES * sizeof(ioring_sqe_t))
+
+/*
+ * Submission entry, written by the program. The operations are the
+ * syscalls of the same number and take the same arguments:
+ *  SYSCALL_OPEN:   arg1 = path, arg2 = mode
+ *  SYSCALL_READ:   fd, arg1 = buffer, arg2 = size
+ *  SYSCALL_WRITE:  fd, arg1 = buffer, arg2 = size
+ *  SYSCALL_CLOSE:  fd
+ *  SYSCALL_LSEEK:  fd, arg1 = offset, arg2 = whence
+ * They run in order, a read after a seek sees the new position.
+ */
+typedef struct ioring_sqe
+{
+    uint32_t opcode;        // 0
+    int32_t fd;             // 4
+    uint32_t arg1;          // 8
+    uint32_t arg2;          // 12
+    uint32_t user_data;     // 16: copied to the completion
+    uint32_t reserved[3];
+}__attribute__((packed)) ioring_sqe_t;
+
+// completion entry, written by the kernel
+typedef struct ioring_cqe
+{
+    uint32_t user_data;     // 0
+    int32_t result;         // 4: what the syscall would have returned
+}__attribute__((packed)) ioring_cqe_t;
+
+/*
+ * Header of the ring page. Free running indexes, an entry is at
+ * index & (IORING_ENTRIES - 1). The program writes sq_tail and cq_head,
+ * the kernel writes sq_head and cq_tail. The offsets are part of the user ABI.
+ */
+typedef struct ioring_shared
+{
+    uint32_t sq_head;       // 0: next submission taken by the kernel
+    uint32_t sq_tail;       // 4: next free submission slot
+    uint32_t cq_head;       // 8: next completion to reap
+    uint32_t cq_tail;       // 12: next completion posted by the kernel
+    uint32_t entries;       // 16
+}__attribute__((packed)) ioring_shared_t;
+
+// kernel side of a ring, the indexes are the trusted copies
+typedef struct ioring
+{
+    volatile ioring_shared_t* shared;
+    volatile ioring_sqe_t* sq;
+    volatile ioring_cqe_t* cq;
+    uint32_t sq_head;
+    uint32_t cq_tail;
+    bool exiting;           // the process is gone, the worker must stop
+
+    process_t* worker;      // kernel thread in the address space of the process
+    wait_queue_t work_wait;         // the worker waits for submissions and completion room
+    wait_queue_t completion_wait;   // ioring_enter waits for completions
+}ioring_t;
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+bool ioring_setup(process_t* owner);
+int ioring_enter(process_t* owner, uint32_t min_complete);
+void ioring_exit(process_t* owner);
@@ -19,21 +19,174 @@
 
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <scheduler/timer.h>
+#include <hal/smp.h>
+#include <hal/fpu.h>
+#include <memmgr/vma.h>
 
 typedef enum status {DEAD, RUNNING, READY, BLOCKED} status_t;
 
+struct mutex;
+
+#define PRIORITY_LEVELS     32                      // one bit per level in the ready bitmap
+#define PRIORITY_HIGHEST    0
+#define PRIORITY_LOWEST     (PRIORITY_LEVELS - 1)
+#define PRIORITY_DEFAULT    (PRIORITY_LEVELS / 2)
+
+// multi-level feedback queue tuning (in timer ticks)
+#define MLFQ_BASE_QUANTUM       5       // time slice of the highest levels
+#define MLFQ_LEVELS_PER_STEP    8       // the time slice doubles every 8 levels
+#define MLFQ_BOOST_PERIOD       1000    // every task goes back to its base priority
+
+// wake up -> running latency histogram, bucket n counts delays in [2^(n-1), 2^n) ticks (bucket 0: < 1 tick)
+#define SCHED_LATENCY_BUCKETS   16
+
+// dead processes kept with their stack and (empty) page directory for the next create_process
+#define PROCESS_POOL_SIZE       8
+
+#define PROCESS_STACK_SIZE      0x1000  // kernel stack of a process
+#define PROCESS_MAX_FILES       8       // files a process can open through the syscalls
+
+// user address space layout (the program is loaded at 0x400000)
+#define USER_HEAP_START         0x10000000  // brk
+#define USER_MMAP_START         0x20000000  // anonymous mmap, grows up
+#define USER_MMAP_END           0xB0000000
+#define USER_STACK_TOP          0xBFFF0000  // ELF programs, paged in like the rest
+#define USER_STACK_SIZE         0x10000
+#define THREAD_MIN_STACK_SIZE   0x1000
+
+// adaptive mutex: yields tried while the owner is runnable before blocking
+#define MUTEX_SPIN_YIELDS       3
+#define MUTEX_PI_MAX_DEPTH      8       // length of a priority inheritance chain
+
 typedef struct process
 {
-    void* phys_pdbr_addr;
+    void* phys_pdbr_addr;   // must stay at offset 0 (context_switch)
     void* virt_pdbr_addr;
-	void* esp;
+	void* esp;              // must stay at offset 8 (context_switch)
     void* stack;
+    size_t stack_size;
     int id;
     bool user;
     status_t status;
+    uint8_t priority;       // current (dynamic) level, 0 is the highest priority
+    uint8_t base_priority;  // level set by setpriority, MLFQ never boosts above it
+    uint32_t time_slice;    // ticks left before the task is demoted
+    uint64_t wake_tick;     // tick of the last wake up, 0 if not waiting to run
+    int cpu;                // run queue it belongs to, the cpu it last ran on
+    bool on_cpu;            // its stack is in use, no other cpu may switch to it yet
+    ktimer_t sleep_timer;   // embedded node for sleep() and wait time outs, no allocation in the timer irq
+    struct wait_queue* waiting_on;  // wait queue the task is blocked on, NULL otherwise
+    uint32_t futex_key;             // physical address waited on in futex_wait, 0 once woken
+
+    // mutexes
+    struct mutex* blocked_on;       // mutex the task waits for
+    struct mutex* held_mutexes;     // mutexes owned by the task
+    bool pi_boosted;                // priority raised by a waiter (priority inheritance)
+    uint8_t pi_saved_priority;      // priority to go back to once nobody waits on it anymore
+
+    // threads
+    struct process* leader;         // owner of the address space, NULL for a process
+    uint32_t address_space_refs;    // leader only: itself + its living threads
+    void (*thread_fn)(void*);
+    void* thread_arg;
+
+    // user resources, only the leader's are used: threads share them
+    int files[PROCESS_MAX_FILES];   // vfs descriptors behind the fds 3 and above, VFS_EBADF if free
+    uint32_t brk;                   // end of the heap, from USER_HEAP_START
+    uint32_t mmap_next;             // next free address of the mmap area
+    struct ioring* ioring;          // asynchronous I/O rings, NULL until set up
+    vma_space_t vmas;               // demand paged areas (ELF segments, stack)
+    int exec_fd;                    // vfs descriptor of the ELF file, VFS_EBADF for a flat binary
+
+    // x87/SSE registers, only saved when another task needs the FPU (lazy switching)
+    uint8_t fpu_buffer[FPU_STATE_SIZE + FPU_STATE_ALIGN - 1];
+    uint8_t* fpu_state;     // aligned inside fpu_buffer
+
+    // accounting (in timer ticks)
+    uint64_t state_tick;    // tick of the last status change
+    uint64_t cpu_ticks;     // time spent RUNNING
+    uint64_t ready_ticks;   // time spent READY waiting for the cpu
+    uint64_t blocked_ticks; // time spent BLOCKED
+    uint32_t voluntary_switches;    // gave the cpu away (blocked, sleep, mutex ...)
+    uint32_t involuntary_switches;  // preempted while still runnable
+
 	struct process *next;
-}__attribute__((packed)) process_t;
+	struct process *prev;
+    struct process *all_next;   // list of every living process (ps)
+    struct process *all_prev;
+}process_t;     // not packed: it embeds kernel objects (timer ...), the asm offsets above don't move
+
+typedef struct sched_stats
+{
+    uint64_t context_switches;      // every prev != next switch
+    uint64_t preemptions;           // switches forced by the scheduler tick
+    uint64_t demotions;             // quantum fully used
+    uint64_t promotions;            // blocked before the end of the quantum
+    uint64_t boosts;                // periodic anti starvation boosts
+    uint64_t wakeups;               // blocked -> ready transitions that got to run
+    uint64_t wake_latency_ticks;    // sum of ready -> running delays after a wake up
+    uint64_t idle_wakeups;          // times the idle task came out of hlt
+    uint64_t tickless_entries;      // one-shot timer armed by the idle task
+    uint32_t wake_latency_hist[SCHED_LATENCY_BUCKETS];
+    uint64_t pool_hits;             // create_process served from the process pool
+    uint64_t pool_misses;           // create_process had to allocate
+    uint64_t priority_inheritances; // mutex owners boosted by a waiter
+    uint64_t steals;                // tasks taken from another cpu run queue (every cpu)
+    uint64_t fpu_loads;             // FPU states restored on a #NM trap (every cpu)
+}sched_stats_t;
+
+// snapshot of a process, filled by get_process_info
+typedef struct process_info
+{
+    int id;
+    bool user;
+    status_t status;
+    uint8_t priority;
+    uint8_t base_priority;
+    uint64_t cpu_ticks;
+    uint64_t ready_ticks;
+    uint64_t blocked_ticks;
+    uint32_t voluntary_switches;
+    uint32_t involuntary_switches;
+}process_info_t;
+
+// per cpu scheduler state, cpus[SMP_getCpuIndex()] is the calling cpu
+typedef struct cpu
+{
+    int id;
+    bool online;
+    process_t* current;
+    process_t* idle;
+    process_t* prev;            // task switched out, finished by the next one (finish_task_switch)
+    uint32_t lock_depth;        // lock_sheduler nesting on this cpu
+    bool need_resched;          // a switch is due, done when the current irq returns
+    process_t* fpu_owner;       // task whose state is in the FPU registers, NULL if none
+
+    // run queue, one FIFO per priority level
+    process_t* first_ready[PRIORITY_LEVELS];
+    process_t* last_ready[PRIORITY_LEVELS];
+    uint32_t ready_bitmap;      // bit n is set when the level n queue isn't empty
+    uint32_t ready_count;
+
+    uint64_t context_switches;
+    uint64_t steals;
+    uint64_t idle_wakeups;
+    uint64_t fpu_loads;
+}cpu_t;
+
+typedef struct cpu_info
+{
+    int id;
+    bool online;
+    int current;                // pid, -1 when idle
+    uint32_t ready_count;
+    uint64_t context_switches;
+    uint64_t steals;
+    uint64_t idle_wakeups;
+}cpu_info_t;
 
 typedef struct mutex
 {
@@ -42,22 +195,68 @@ typedef struct mutex
     process_t* owner;
     process_t* first_waiting_list;
     process_t* last_waiting_list;
+
+    const char* name;
+    struct mutex* next_held;        // in the owner's list of held mutexes
+    struct mutex* next_mutex;       // registry, for the statistics
+    bool registered;
+
+    // contention statistics
+    uint64_t acquisitions;
+    uint64_t contended;             // the mutex was locked by another task
+    uint64_t spin_acquisitions;     // contended but taken before blocking
+    uint64_t wait_ticks;            // time spent waiting for it
 }mutex_t;
 
+// for statically allocated mutexes
+#define MUTEX_INIT(mutex_name) { .locked = false, .locked_count = 0, .owner = NULL,    \
+                                 .first_waiting_list = NULL, .last_waiting_list = NULL, \
+                                 .name = mutex_name, .registered = false }
+
+typedef struct mutex_stats
+{
+    const char* name;
+    bool locked;
+    int owner;                      // pid, -1 if free
+    uint32_t waiters;
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t spin_acquisitions;
+    uint64_t wait_ticks;
+}mutex_stats_t;
+
 void yield();
 void initialize_multitasking();
-void create_process(void* task, bool is_user);
+void start_other_cpus();
+process_t* create_process(void* task, bool is_user);
+process_t* create_thread(void (*fn)(void*), void* arg, size_t stack_size);
 void __attribute__((cdecl)) context_switch(process_t* current, process_t* next);
 
+void scheduler_tick();
+void scheduler_irq_exit();
+void idle_loop();
+void set_tickless_idle(bool enable);
+void get_scheduler_stats(sched_stats_t* stats);
+int get_process_info(process_info_t* info, int max_count);
+int get_cpu_info(cpu_info_t* info, int max_count);
+
 void lock_sheduler();
 void unlock_sheduler();
 
+process_t* get_current_process();
+void block_current_task();
+void unblock_task(process_t* proc);
+
 void terminate_task();
 
+void setpriority(process_t* proc, uint8_t priority);
+uint8_t getpriority(process_t* proc);
+
 void sleep(uint32_t ms);
-void wakeUp();
 
 mutex_t* create_mutex();
+mutex_t* create_named_mutex(const char* name);
+int get_mutex_stats(mutex_stats_t* stats, int max_count);
 void destroy_mutex(mutex_t* mut);
 void acquire_mutex(mutex_t* mut);
 void release_mutex(mutex_t* mut);
\ No newline at end of file
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <hal/io.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+typedef struct spinlock
+{
+    volatile uint32_t locked;
+}spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+// busy waiting: only for short sections, with interrupts disabled on the local cpu
+void __attribute__((cdecl)) spin_lock(spinlock_t* lock);
+bool __attribute__((cdecl)) spin_trylock(spinlock_t* lock);
+void __attribute__((cdecl)) spin_unlock(spinlock_t* lock);
+
+// for data also used by interrupt handlers or by code that must not be preempted while holding it
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock)
+{
+    uint32_t flags = disableInterruptsSave();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags)
+{
+    spin_unlock(lock);
+    restoreInterrupts(flags);
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+typedef void (*timer_callback_t)(void* arg);
+
+/*
+ * A kernel timer. The node is embedded by its owner (process, driver ...),
+ * the timer wheel never allocates memory.
+ * Callbacks run from the timer irq with interrupts disabled.
+ */
+typedef struct ktimer
+{
+    struct ktimer* next;
+    struct ktimer* prev;
+    struct ktimer** slot;       // wheel slot the timer is linked in
+    uint64_t expires;           // absolute tick count
+    timer_callback_t callback;
+    void* arg;
+    bool pending;
+}ktimer_t;
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void timer_init(ktimer_t* timer, timer_callback_t callback, void* arg);
+void timer_add(ktimer_t* timer, uint32_t ms);
+bool timer_cancel(ktimer_t* timer);
+void timer_tick();
+uint32_t timer_next_event(uint32_t max_ticks);
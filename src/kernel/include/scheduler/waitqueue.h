@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <hal/pit.h>
+#include <scheduler/multitask.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+/*
+ * FIFO of blocked tasks. The tasks are linked through their next/prev
+ * pointers (a blocked task is never on a ready queue). Waking up is safe
+ * from an irq handler.
+ */
+typedef struct wait_queue
+{
+    process_t* first;
+    process_t* last;
+}wait_queue_t;
+
+typedef struct semaphore
+{
+    int32_t count;
+    wait_queue_t waiters;
+}semaphore_t;
+
+typedef struct condvar
+{
+    wait_queue_t waiters;
+}condvar_t;
+
+/*
+ * Reader-writer lock with writer preference: once a writer waits, new
+ * readers queue behind it so writers can't starve. Not recursive.
+ */
+typedef struct rwlock
+{
+    uint32_t readers;           // readers holding the lock
+    bool writer;                // a writer holds the lock
+    uint32_t writers_waiting;
+    wait_queue_t read_queue;
+    wait_queue_t write_queue;
+}rwlock_t;
+
+/*
+ * Block the current task until 'condition' is true. The condition is
+ * evaluated with the scheduler locked, so a wake up between the test and
+ * the block can't be lost. Don't call it with the scheduler locked.
+ */
+#define wait_event(wq, condition)           \
+    do                                      \
+    {                                       \
+        lock_sheduler();                    \
+        while(!(condition))                 \
+        {                                   \
+            wait_queue_block(wq);           \
+            unlock_sheduler();              \
+            yield();                        \
+            lock_sheduler();                \
+        }                                   \
+        wait_queue_finish(wq);              \
+        unlock_sheduler();                  \
+    } while(0)
+
+// same as wait_event but gives up after 'ms', evaluates to false on time out
+#define wait_event_timeout(wq, condition, ms)                       \
+    ({                                                              \
+        bool __done = true;                                         \
+        uint64_t __deadline = getTickCount() + (ms);                \
+        lock_sheduler();                                            \
+        while(!(condition))                                         \
+        {                                                           \
+            uint64_t __now = getTickCount();                        \
+            if(__now >= __deadline)                                 \
+            {                                                       \
+                __done = false;                                     \
+                break;                                              \
+            }                                                       \
+            wait_queue_block_timeout(wq, __deadline - __now);       \
+            unlock_sheduler();                                      \
+            yield();                                                \
+            lock_sheduler();                                        \
+        }                                                           \
+        wait_queue_finish(wq);                                      \
+        unlock_sheduler();                                          \
+        __done;                                                     \
+    })
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void wait_queue_init(wait_queue_t* wq);
+void wait_queue_block(wait_queue_t* wq);
+void wait_queue_block_timeout(wait_queue_t* wq, uint32_t ms);
+void wait_queue_finish(wait_queue_t* wq);
+bool wait_queue_empty(wait_queue_t* wq);
+uint32_t wake_up_one(wait_queue_t* wq);
+uint32_t wake_up_all(wait_queue_t* wq);
+void wake_up_task_locked(wait_queue_t* wq, process_t* proc);
+
+void semaphore_init(semaphore_t* sem, int32_t count);
+void semaphore_down(semaphore_t* sem);
+bool semaphore_down_timeout(semaphore_t* sem, uint32_t ms);
+bool semaphore_trydown(semaphore_t* sem);
+void semaphore_up(semaphore_t* sem);
+
+void condvar_init(condvar_t* cv);
+void condvar_wait(condvar_t* cv, mutex_t* mut);
+void condvar_signal(condvar_t* cv);
+void condvar_broadcast(condvar_t* cv);
+
+void rwlock_init(rwlock_t* lock);
+void read_lock(rwlock_t* lock);
+void read_unlock(rwlock_t* lock);
+void write_lock(rwlock_t* lock);
+void write_unlock(rwlock_t* lock);
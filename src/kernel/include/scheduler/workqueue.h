@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define WORKQUEUE_SIZE      64      // pending work items, the oldest are never overwritten
+
+typedef void (*work_func_t)(void* arg);
+
+typedef struct work_stats
+{
+    uint64_t queued;
+    uint64_t executed;
+    uint64_t dropped;               // the queue was full
+    uint32_t max_pending;           // deepest the queue has been
+    uint64_t latency_ticks;         // sum of queue -> run delays
+}work_stats_t;
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void workqueue_init();
+bool schedule_work(work_func_t func, void* arg);
+void get_workqueue_stats(work_stats_t* stats);
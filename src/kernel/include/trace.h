@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+//============================================================================
+//    INTERFACE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define TRACE_BUFFER_EVENTS     1024    // per cpu, power of two
+
+typedef enum {
+    TRACE_SWITCH = 1,           // prev pid, next pid
+    TRACE_IRQ_ENTRY,            // irq
+    TRACE_IRQ_EXIT,             // irq
+    TRACE_SYSCALL_ENTRY,        // number, first argument
+    TRACE_SYSCALL_EXIT,         // number, result
+    TRACE_PAGE_FAULT,           // address, error code
+    TRACE_KMALLOC,              // size, block
+    TRACE_KFREE,                // block
+    TRACE_FDC_READ,             // lba, sector count
+    TRACE_FDC_DONE,             // lba, sector count
+}TRACE_EVENT;
+
+typedef struct {
+    uint64_t timestamp;         // clock_cycles(): tsc cycles, ns without a tsc
+    uint16_t event;
+    uint16_t cpu;
+    uint32_t arg1;
+    uint32_t arg2;
+    uint32_t reserved;
+} __attribute__((packed)) trace_record_t;
+
+extern volatile bool g_traceEnabled;
+
+// a tracepoint is a load and a branch while tracing is off
+#define trace(event, arg1, arg2) \
+    do { if(g_traceEnabled) TRACE_record((event), (uint32_t)(arg1), (uint32_t)(arg2)); } while(0)
+
+//============================================================================
+//    INTERFACE FUNCTION PROTOTYPES
+//============================================================================
+
+void TRACE_record(uint16_t event, uint32_t arg1, uint32_t arg2);
+void TRACE_enable(bool enable);
+void TRACE_clear();
+void TRACE_dump();
+uint32_t TRACE_getCount(int cpu);
@@ -42,6 +42,7 @@ typedef enum
     VFS_ENOENT     = -2,    /* File or directory not found */
     VFS_EEXIST     = -3,    /* File already exists */
     VFS_EACCESS    = -4,    /* Permission denied */
+    VFS_EINVAL     = -5,    /* Invalid argument */
     VFS_EISDIR     = -9,    /* Is a directory */
     VFS_ENOTDIR    = -10,   /* Not a directory */
     VFS_ENFILE     = -11,   /* Too many open files */
@@ -120,6 +121,9 @@ typedef struct vnodeops
 
     /* Find a file/directory by name */
     int (*lookup)(struct vnode* node_dir, const char* name, struct vnode** result);
+
+    /* Size of a regular file in bytes */
+    int (*getsize)(struct vnode* node, uint32_t* size);
 }vnodeops_t;
 
 
@@ -136,6 +140,13 @@ typedef struct vfs_file
 
 typedef int fd_t;   // file descriptor
 
+typedef enum
+{
+    VFS_SEEK_SET = 0,   // from the start of the file
+    VFS_SEEK_CUR = 1,   // from the current position
+    VFS_SEEK_END = 2,   // from the end of the file
+} vfs_seek_t;
+
 //============================================================================
 //    INTERFACE FUNCTION PROTOTYPES
 //============================================================================
@@ -143,6 +154,9 @@ typedef int fd_t;   // file descriptor
 void VFS_init();
 void VFS_register_new_filesystem(filesystem_t* fs);
 
+void VFS_hold_vnode(vnode_t* vnode);
+void VFS_release_vnode(vnode_t* vnode);
+
 int VFS_mount(const char *fs_name, const char *mount_point);
 int VFS_unmount(const char *mount_point);
 
@@ -150,6 +164,7 @@ fd_t VFS_open(const char *path, uint16_t mode);
 int VFS_close(fd_t descriptor);
 
 size_t VFS_read(fd_t fd, void *buffer, size_t size);
+int VFS_lseek(fd_t fd, int32_t offset, int whence);
 
 #define VFS_FD_STDOUT   -1
 #define VFS_FD_STDERR   -2
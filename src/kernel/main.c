@@ -26,6 +26,8 @@
 #include <memory.h>
 #include <shell.h>
 #include <hal/hal.h>
+#include <hal/smp.h>
+#include <hal/userinfo.h>
 #include <drivers/fdc.h>
 #include <drivers/keyboard.h>
 #include <vfs/vfs.h>
@@ -36,6 +38,7 @@
 #include <memmgr/virtmem_manager.h>
 #include <memmgr/heap.h>
 #include <memmgr/vmalloc.h>
+#include <memmgr/vma.h>
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DATA
@@ -153,19 +156,21 @@ void __attribute__((cdecl)) start(Boot_info* info)
 {
     HAL_initialize(info);
     PHYSMEM_initialize(info);
+    SMP_reserveTrampoline();  // before anything else takes the low memory
     VIRTMEM_initialize();
     HEAP_initialize();
     VMALLOC_initialize();
+    VMA_initialize();
+    USERINFO_initialize();
+    SMP_initialize();
+    IRQ_enableApic();
     initialize_multitasking();
     create_process(init_process, false);
+    start_other_cpus();
     enable_multitasking();    // preemptive multitasking
     //yield();
 
-    for(;;)
-    {
-        HLT();
-        //yield();
-    }
+    idle_loop();    // we are the idle task from now on
         
 
     while(1)
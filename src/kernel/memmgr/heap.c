@@ -23,6 +23,8 @@
 #include <memmgr/virtmem_manager.h>
 #include <memmgr/heap.h>
 #include <ordered_array.h>
+#include <scheduler/spinlock.h>
+#include <trace.h>
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
@@ -54,6 +56,8 @@ uint32_t lastHeapAllocatedPage;
 header_t *head = NULL, *tail = NULL;
 ordered_array freeBlockArray;
 
+spinlock_t heap_lock = SPINLOCK_INIT;    // shared by every cpu
+
 //============================================================================
 //    IMPLEMENTATION PRIVATE FUNCTIONS
 //============================================================================
@@ -143,7 +147,10 @@ void* sbrk(intptr_t size)
     return ptr;
 }
 
-void* kmalloc(size_t size)
+static void heap_free(void* block);
+
+// the heap lock is held by the callers (kmalloc, kfree)
+static void* heap_alloc(size_t size)
 {
     void *block;
     header_t *header = NULL;
@@ -174,7 +181,7 @@ void* kmalloc(size_t size)
             header->next = newHeader;
             header->size = size;
 
-            kfree((void*)newHeader + sizeof(header_t)); // add a new free block !
+            heap_free((void*)newHeader + sizeof(header_t)); // add a new free block !
 
             if(header == tail)
                 tail = newHeader;
@@ -251,7 +258,7 @@ void* kcalloc(size_t num, size_t size)
     return pointer;
 }
 
-void kfree(void* block)
+static void heap_free(void* block)
 {
     if(block == NULL)
         return;
@@ -322,3 +329,23 @@ void kfree(void* block)
         remove_ordered_array(getIndex_ordered_array(header, &freeBlockArray), &freeBlockArray); // in all case we need to remove it from the free list array
     }
 }
+
+void* kmalloc(size_t size)
+{
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    void* block = heap_alloc(size);
+    spin_unlock_irqrestore(&heap_lock, flags);
+
+    trace(TRACE_KMALLOC, size, block);
+
+    return block;
+}
+
+void kfree(void* block)
+{
+    trace(TRACE_KFREE, block, 0);
+
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    heap_free(block);
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
@@ -45,6 +45,12 @@ getPDBR:
     mov eax, cr3
     ret
 
+; linear address of the last page fault
+global getPageFaultAddress
+getPageFaultAddress:
+    mov eax, cr2
+    ret
+
 global switchPDBR
 switchPDBR:
     ; make new call frame
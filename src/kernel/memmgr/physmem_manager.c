@@ -24,6 +24,7 @@
 #include <memmgr/physmem_manager.h>
 #include <memory.h>
 #include <utility.h>
+#include <scheduler/spinlock.h>
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
@@ -52,6 +53,8 @@ uint32_t totalFreeBlock     = 0;
 uint32_t totalUsedBlock     = 0;
 uint32_t bitmapSize;
 
+spinlock_t physmem_lock = SPINLOCK_INIT;
+
 //============================================================================
 //    IMPLEMENTATION PRIVATE FUNCTION PROTOTYPES
 //============================================================================
@@ -233,17 +236,44 @@ void PHYSMEM_initialize(Boot_info* info)
 
 void* PHYSMEM_AllocBlock()
 {
+    uint32_t flags = spin_lock_irqsave(&physmem_lock);
     uint32_t block = PHYSMEM_firstFreeBlock();
 
     if(block == -1)
+    {
+        spin_unlock_irqrestore(&physmem_lock, flags);
         return NULL;
+    }
     PHYSMEM_setBlockToUsed(block);
     totalUsedBlock++;
     totalFreeBlock--;
 
+    spin_unlock_irqrestore(&physmem_lock, flags);
     return (void*)(block * BLOCK_SIZEKB * 0x400);
 }
 
+// the highest free block under 'limit', block 0 (real mode ivt) is never given
+void* PHYSMEM_allocBlockBelow(uint32_t limit)
+{
+    uint32_t flags = spin_lock_irqsave(&physmem_lock);
+
+    for(int block = limit / (BLOCK_SIZEKB * 0x400) - 1; block > 0; block--)
+    {
+        if(PHYSMEM_checkIfBlockUsed(block) == 0)
+        {
+            PHYSMEM_setBlockToUsed(block);
+            totalUsedBlock++;
+            totalFreeBlock--;
+
+            spin_unlock_irqrestore(&physmem_lock, flags);
+            return (void*)(block * BLOCK_SIZEKB * 0x400);
+        }
+    }
+
+    spin_unlock_irqrestore(&physmem_lock, flags);
+    return NULL;
+}
+
 void* PHYSMEM_AllocBlocks(uint8_t block_size)
 {
     uint32_t index;
@@ -252,8 +282,13 @@ void* PHYSMEM_AllocBlocks(uint8_t block_size)
 
     uint16_t debug = 0;
 
+    uint32_t flags = spin_lock_irqsave(&physmem_lock);
+
     if(block_size > totalFreeBlock)
+    {
+        spin_unlock_irqrestore(&physmem_lock, flags);
         return NULL;
+    }
     
     index = PHYSMEM_firstFreeBlock();
     block_addr = index;
@@ -270,6 +305,7 @@ void* PHYSMEM_AllocBlocks(uint8_t block_size)
                 totalFreeBlock--;
             }
             
+            spin_unlock_irqrestore(&physmem_lock, flags);
             return (void*)(block_addr * BLOCK_SIZEKB * 0x400);
         }
 
@@ -284,6 +320,7 @@ void* PHYSMEM_AllocBlocks(uint8_t block_size)
         count++;
     }
     
+    spin_unlock_irqrestore(&physmem_lock, flags);
     return NULL;
 }
 
@@ -294,9 +331,11 @@ void PHYSMEM_freeBlock(void* ptr)
 
     uint32_t block = (uint32_t)ptr / (BLOCK_SIZEKB * 0x400);
 
+    uint32_t flags = spin_lock_irqsave(&physmem_lock);
     PHYSMEM_setBlockToFree(block);
     totalUsedBlock--;
     totalFreeBlock++;
+    spin_unlock_irqrestore(&physmem_lock, flags);
 }
 
 void PHYSMEM_freeBlocks(void* ptr, uint8_t size)
@@ -306,10 +345,14 @@ void PHYSMEM_freeBlocks(void* ptr, uint8_t size)
 
     uint32_t block = (uint32_t)ptr / (BLOCK_SIZEKB * 0x400);
 
+    uint32_t flags = spin_lock_irqsave(&physmem_lock);
+
     for(int i = 0; i < size; i++)
     {
         PHYSMEM_setBlockToFree(block + i);
         totalUsedBlock--;
         totalFreeBlock++;
     }
+
+    spin_unlock_irqrestore(&physmem_lock, flags);
 }
\ No newline at end of file
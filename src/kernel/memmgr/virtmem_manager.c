@@ -175,6 +175,71 @@ bool VIRTMEM_unMapPage (void* virt)
     return true;
 }
 
+// make a mapped page read-only
+bool VIRTMEM_writeProtectPage(void* virt)
+{
+    PDE* page_directory = (PDE*)0xFFFFF000; // virtual addresse of the page directory
+
+    uint32_t pageTableIndex = PDE_INDEX((uint32_t)virt);
+    PTE* page_table = (PTE*)(0xFFC00000 + (pageTableIndex << 12));   // virtuall addresse of the page table
+
+    if((page_directory[pageTableIndex] & PDE_PRESENT) != PDE_PRESENT)
+        return false;
+
+    uint32_t pageEntryIndex = PTE_INDEX((uint32_t)virt);
+    if((page_table[pageEntryIndex] & PTE_PAGE_PRESENT) != PTE_PAGE_PRESENT)
+        return false;
+
+    page_table[pageEntryIndex] &= ~PTE_PAGE_WRITE;
+
+    flushTLB(virt);
+    return true;
+}
+
+// map a caller supplied frame, the frame is not owned by the virtual memory manager
+bool VIRTMEM_mapPhysPage(void* virt, void* phys, uint32_t flags)
+{
+    if((uint32_t)virt >= 0xFFC00000) // arealdy used by recursive mapping
+        return false;
+
+    if(!VIRTMEM_mapTable(virt, (flags & PTE_PAGE_USER_MODE) != PTE_PAGE_USER_MODE))
+        return false;
+
+    uint32_t pageTableIndex = PDE_INDEX((uint32_t)virt);
+    PTE* page_table = (PTE*)(0xFFC00000 + (pageTableIndex << 12));   // virtuall addresse of the page table
+
+    uint32_t pageEntryIndex = PTE_INDEX((uint32_t)virt);
+    page_table[pageEntryIndex] = PAGE_ADD_ATTRIBUTE(((uint32_t)phys & 0xFFFFF000), flags | PTE_PAGE_PRESENT);
+
+    flushTLB(virt);
+    return true;
+}
+
+// unmap a page without giving its frame back to the physical memory manager
+void* VIRTMEM_unMapPhysPage(void* virt)
+{
+    if((uint32_t)virt >= 0xFFC00000) // arealdy used by recursive mapping
+        return NULL;
+
+    PDE* page_directory = (PDE*)0xFFFFF000; // virtual addresse of the page directory
+
+    uint32_t pageTableIndex = PDE_INDEX((uint32_t)virt);
+    PTE* page_table = (PTE*)(0xFFC00000 + (pageTableIndex << 12));   // virtuall addresse of the page table
+
+    if((page_directory[pageTableIndex] & PDE_PRESENT) != PDE_PRESENT)
+        return NULL;    // already unmapped
+
+    uint32_t pageEntryIndex = PTE_INDEX((uint32_t)virt);
+    if((page_table[pageEntryIndex] & PTE_PAGE_PRESENT) != PTE_PAGE_PRESENT)
+        return NULL; // page already unmapped nothing to do
+
+    void* frame = (void*)(page_table[pageEntryIndex] & 0xFFFFF000);
+    page_table[pageEntryIndex] = 0x0; // page not present
+
+    flushTLB(virt);
+    return frame;
+}
+
 uint32_t* VIRTMEM_getPhysAddr(void* virt)
 {   
     uint32_t pageTableIndex = PDE_INDEX((uint32_t)virt);
@@ -185,6 +250,35 @@ uint32_t* VIRTMEM_getPhysAddr(void* virt)
     return (uint32_t*)(page_table[pageEntryIndex] & 0xFFFFF000);
 }
 
+// check that a buffer handed in by user mode is mapped for it in the current address space
+bool VIRTMEM_isUserRange(const void* virt, size_t size, bool write)
+{
+    PDE* page_directory = (PDE*)0xFFFFF000; // virtual addresse of the page directory
+
+    uint32_t start = (uint32_t)virt;
+    uint32_t end = start + size;
+
+    if(end < start || end > 0xC0000000)
+        return false;   // wraps around or reaches into the kernel
+
+    uint32_t required = PTE_PAGE_PRESENT | PTE_PAGE_USER_MODE;
+    if(write)
+        required |= PTE_PAGE_WRITE;
+
+    for(uint32_t page = start & 0xFFFFF000; page < end; page += 0x1000)
+    {
+        uint32_t pageTableIndex = PDE_INDEX(page);
+        if((page_directory[pageTableIndex] & required) != required)
+            return false;
+
+        PTE* page_table = (PTE*)(0xFFC00000 + (pageTableIndex << 12));   // virtuall addresse of the page table
+        if((page_table[PTE_INDEX(page)] & required) != required)
+            return false;
+    }
+
+    return true;
+}
+
 void VIRTMEM_initialize()
 {
     log_info("kernel", "Initializing virtual memory manager...");
@@ -261,21 +355,48 @@ uint32_t* VIRTMEM_createAddressSpace()
 
 // this function suppose that you provide a virtual address of the page directory
 void VIRTMEM_destroyAddressSpace(PDE* page_directory)
+{
+    VIRTMEM_clearAddressSpace(page_directory);
+    vfree(page_directory);
+}
+
+// free every user page and page table (4mb to 3gb), the directory itself stays allocated
+void VIRTMEM_clearAddressSpace(PDE* page_directory)
 {
     PDE* current_page_directory = (PDE*)0xFFFFF000; // virtual addresse of the current page directory
 
-    // we need to deallocate all allocated page between 4mb and 3gb
-    // so we need to first get access of those pages
     for(int i = 1; i < 768; i++)
-        current_page_directory[i] = page_directory[i];   // map all the page from 4mb to 3gb
+    {
+        if((page_directory[i] & PDE_PRESENT) != PDE_PRESENT)
+            continue;   // only walk the tables that exist
+
+        // borrow the slot in the current directory to reach the table through the recursive mapping
+        PTE* page_table = (PTE*)(0xFFC00000 + (i << 12));
+        current_page_directory[i] = page_directory[i];
+        flushTLB((uint32_t*)page_table);
+
+        for(int j = 0; j < 1024; j++)
+        {
+            if((page_table[j] & PTE_PAGE_SHARED) == PTE_PAGE_SHARED)
+                page_table[j] = 0;  // somebody else's frame
+            else if((page_table[j] & PTE_PAGE_PRESENT) == PTE_PAGE_PRESENT)
+                VIRTMEM_freePage(&page_table[j]);
+        }
+
+        PHYSMEM_freeBlock((void*)(page_directory[i] & 0xFFFFF000));
+        page_directory[i] = 0;
+        current_page_directory[i] = 0;
+        flushTLB((uint32_t*)page_table);
+    }
+}
 
-    // unmap pages from 4mb to 3gb
-    for(int i = 0x400000; i < 0xc0000000; i += 0x1000)
-        VIRTMEM_unMapPage((void*)i);
+// copy the kernel mappings again, a recycled directory may miss page tables created since
+void VIRTMEM_refreshKernelSpace(PDE* page_directory)
+{
+    PDE* current_page_directory = (PDE*)0xFFFFF000; // virtual addresse of the current page directory
 
-    // unmap page tables from 4mb to 3gb
-    for(int i = 0x400000; i < 0xc0000000; i += 0x400000)
-        VIRTMEM_unMapTable((void*)i);
+    page_directory[0] = current_page_directory[0];
 
-    vfree(page_directory);
+    for(int i = 768; i < 1023; i++)
+        page_directory[i] = current_page_directory[i];
 }
\ No newline at end of file
@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <debug.h>
+#include <memory.h>
+#include <hal/io.h>
+#include <hal/isr.h>
+#include <memmgr/memory_manager.h>
+#include <memmgr/physmem_manager.h>
+#include <memmgr/virtmem_manager.h>
+#include <memmgr/vmalloc.h>
+#include <memmgr/vma.h>
+#include <scheduler/multitask.h>
+#include <scheduler/waitqueue.h>
+#include <vfs/vfs.h>
+#include <trace.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define PAGE_SIZE               0x1000
+#define PAGE_FAULT_VECTOR       14
+
+#define PF_PRESENT              0x1     // protection violation, not a missing page
+#define PF_WRITE                0x2
+
+#define EFLAGS_IF               0x200
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+// one fault at a time: the areas of a file share its position
+mutex_t g_faultLock = MUTEX_INIT("page fault");
+
+// every space waiting on a hold or a shrink, they are rare and short
+wait_queue_t g_spaceQueue = { NULL, NULL };
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+// threads fault in the address space of their process
+static vma_space_t* current_space()
+{
+    process_t* proc = get_current_process();
+    return proc->leader != NULL ? &proc->leader->vmas : &proc->vmas;
+}
+
+static vma_t* find_area(vma_space_t* space, uint32_t addr)
+{
+    for(int i = 0; i < space->count; i++)
+    {
+        if(addr >= space->areas[i].start && addr < space->areas[i].end)
+            return &space->areas[i];
+    }
+
+    return NULL;
+}
+
+// fill a frame with the content of one page of the area
+static bool fill_frame(vma_t* area, uint32_t page, void* frame)
+{
+    bool filled = true;
+
+    uint8_t* fill = vmap(&frame, 1, PTE_PAGE_WRITE);
+    if(fill == NULL)
+        return false;
+
+    memset(fill, 0, PAGE_SIZE);  // bss, and the tail of the last file page
+
+    uint32_t offset = page - area->start;
+
+    if(area->fd >= 0 && offset < area->file_size)
+    {
+        uint32_t size = area->file_size - offset;
+        if(size > PAGE_SIZE)
+            size = PAGE_SIZE;
+
+        if(VFS_lseek(area->fd, area->file_offset + offset, VFS_SEEK_SET) < 0 ||
+           (int)VFS_read(area->fd, fill, size) != (int)size)
+            filled = false;
+    }
+
+    vunmap(fill);
+    return filled;
+}
+
+/*
+ * Load one page of the area, the fault lock is held. The frame is filled
+ * through a kernel only mapping: the other threads of the process (and its
+ * ioring worker) don't fault on a present page and would see it half loaded.
+ */
+static bool load_page(vma_t* area, uint32_t page)
+{
+    void* frame = PHYSMEM_AllocBlock();
+    if(frame == NULL)
+        return false;
+
+    uint32_t flags = PTE_PAGE_USER_MODE;
+    if((area->flags & VMA_WRITE) == VMA_WRITE)
+        flags |= PTE_PAGE_WRITE;
+
+    // owned by the address space from here on, freed when it goes away
+    if(!fill_frame(area, page, frame) || !VIRTMEM_mapPhysPage((void*)page, frame, flags))
+    {
+        PHYSMEM_freeBlock(frame);
+        return false;
+    }
+
+    return true;
+}
+
+static bool handle_fault(uint32_t addr, bool write)
+{
+    vma_space_t* space = current_space();
+    bool handled = false;
+
+    acquire_mutex(&g_faultLock);
+
+    vma_t* area = find_area(space, addr);
+
+    if(area != NULL && (!write || (area->flags & VMA_WRITE) == VMA_WRITE))
+    {
+        uint32_t page = addr & ~(PAGE_SIZE - 1);
+
+        // another thread of the process may have loaded it while we waited
+        handled = VIRTMEM_isUserRange((void*)page, 1, false) || load_page(area, page);
+    }
+
+    release_mutex(&g_faultLock);
+    return handled;
+}
+
+static void page_fault(Registers* regs)
+{
+    uint32_t addr = getPageFaultAddress();
+    bool user = (regs->cs & 3) == 3;
+
+    trace(TRACE_PAGE_FAULT, addr, regs->error);
+
+    // the kernel only faults on user memory where it could sleep (syscalls)
+    if((regs->error & PF_PRESENT) == 0 && addr < 0xC0000000 && (user || (regs->eflags & EFLAGS_IF)))
+    {
+        enableInterrupts();     // the page may come from the floppy
+
+        if(handle_fault(addr, (regs->error & PF_WRITE) == PF_WRITE))
+            return;
+    }
+
+    if(user)
+    {
+        log_err("vma", "pid %d: page fault at %x (eip %x, error %x), killed", get_current_process()->id, addr, regs->eip, regs->error);
+        enableInterrupts();
+        terminate_task();
+        return;
+    }
+
+    printf("Page fault at %x, eip=%x error=%x\n", addr, regs->eip, regs->error);
+    puts("KERNEL PANIC!\n");
+    panic();
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+void VMA_initialize()
+{
+    log_info("kernel", "Initializing demand paging...");
+    ISR_registerNewHandler(PAGE_FAULT_VECTOR, page_fault);
+}
+
+void VMA_initSpace(vma_space_t* space)
+{
+    space->count = 0;
+    space->holders = 0;
+    space->shrinking = false;
+}
+
+// reserve [start, end) in the user address space, nothing is mapped before the first access
+bool VMA_add(vma_space_t* space, uint32_t start, uint32_t end, uint32_t flags, int fd, uint32_t file_offset, uint32_t file_size)
+{
+    if(space->count >= VMA_MAX_AREAS || start >= end || end > 0xC0000000)
+        return false;
+
+    if((start & (PAGE_SIZE - 1)) != 0 || (end & (PAGE_SIZE - 1)) != 0)
+        return false;
+
+    for(int i = 0; i < space->count; i++)
+    {
+        if(start < space->areas[i].end && end > space->areas[i].start)
+            return false;   // overlaps
+    }
+
+    vma_t* area = &space->areas[space->count++];
+    area->start = start;
+    area->end = end;
+    area->flags = flags;
+    area->fd = fd;
+    area->file_offset = file_offset;
+    area->file_size = file_size;
+
+    return true;
+}
+
+/*
+ * Move the end of the area beginning at start (the heap), create it if it
+ * doesn't exist and remove it when it becomes empty. The pages cut off
+ * stay mapped, the caller unmaps them.
+ */
+bool VMA_resize(vma_space_t* space, uint32_t start, uint32_t end, uint32_t flags)
+{
+    bool resized = true;
+
+    acquire_mutex(&g_faultLock);   // no fault looks at the areas meanwhile
+
+    int index = 0;
+    while(index < space->count && space->areas[index].start != start)
+        index++;
+
+    if(index == space->count)
+    {
+        if(end != start)
+            resized = VMA_add(space, start, end, flags, -1, 0, 0);
+    }
+    else if(end == start)
+    {
+        space->count--;
+        space->areas[index] = space->areas[space->count];
+    }
+    else
+    {
+        for(int i = 0; i < space->count; i++)
+        {
+            if(i != index && start < space->areas[i].end && end > space->areas[i].start)
+                resized = false;    // would overlap
+        }
+
+        if(end < start || (end & (PAGE_SIZE - 1)) != 0 || end > 0xC0000000)
+            resized = false;
+
+        if(resized)
+            space->areas[index].end = end;
+    }
+
+    release_mutex(&g_faultLock);
+    return resized;
+}
+
+/*
+ * Load the missing pages of a user buffer before the kernel checks and uses
+ * it (syscalls), so a read into a fresh bss works. Pages outside of any area
+ * are left alone: the check after it fails as before.
+ */
+bool VMA_populate(const void* virt, size_t size, bool write)
+{
+    uint32_t start = (uint32_t)virt;
+    uint32_t end = start + size;
+
+    if(end < start || end > 0xC0000000)
+        return false;
+
+    for(uint32_t page = start & ~(PAGE_SIZE - 1); page < end; page += PAGE_SIZE)
+    {
+        if(!VIRTMEM_isUserRange((void*)page, 1, false) && !handle_fault(page, write))
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * A syscall holds the space from its user range check to the end of the
+ * copy, so the pages it checked stay mapped. Several can hold it at once
+ * (the process and its ioring worker); don't block indefinitely while holding.
+ */
+void VMA_hold(vma_space_t* space)
+{
+    lock_sheduler();
+
+    while(space->shrinking)
+    {
+        wait_queue_block(&g_spaceQueue);
+        unlock_sheduler();
+        yield();
+        lock_sheduler();
+    }
+
+    space->holders++;
+    wait_queue_finish(&g_spaceQueue);
+
+    unlock_sheduler();
+}
+
+void VMA_unhold(vma_space_t* space)
+{
+    lock_sheduler();
+
+    space->holders--;
+
+    if(space->holders == 0 && space->shrinking)
+        wake_up_all(&g_spaceQueue);
+
+    unlock_sheduler();
+}
+
+// wait until no syscall holds the space, new ones wait until VMA_endShrink
+void VMA_beginShrink(vma_space_t* space)
+{
+    lock_sheduler();
+
+    while(space->shrinking)
+    {
+        wait_queue_block(&g_spaceQueue);
+        unlock_sheduler();
+        yield();
+        lock_sheduler();
+    }
+
+    space->shrinking = true;
+
+    while(space->holders > 0)
+    {
+        wait_queue_block(&g_spaceQueue);
+        unlock_sheduler();
+        yield();
+        lock_sheduler();
+    }
+
+    wait_queue_finish(&g_spaceQueue);
+
+    unlock_sheduler();
+}
+
+void VMA_endShrink(vma_space_t* space)
+{
+    lock_sheduler();
+
+    space->shrinking = false;
+    wake_up_all(&g_spaceQueue);
+
+    unlock_sheduler();
+}
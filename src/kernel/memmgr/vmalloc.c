@@ -24,6 +24,8 @@
 #include <memory.h>
 #include <utility.h>
 #include <memmgr/vmalloc.h>
+#include <hal/smp.h>
+#include <scheduler/spinlock.h>
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
@@ -46,6 +48,7 @@ typedef struct tracking_list
 {
     uint32_t addr;
     uint32_t block_size;
+    bool own_frames;    // false for vmap/ioremap, the frames belong to the caller
     struct tracking_list* next;
 }tracking_list_t;
 
@@ -61,6 +64,8 @@ uint32_t vmalloc_bitmapSize;
 
 tracking_list_t* tracking_head = NULL;
 
+spinlock_t vmalloc_lock = SPINLOCK_INIT;   // bitmap and tracking list
+
 //============================================================================
 //    IMPLEMENTATION PRIVATE FUNCTIONS
 //============================================================================
@@ -113,8 +118,13 @@ void* VMALLOC_findFreeRange(uint32_t block_size)
     uint32_t block_addr;
     uint32_t count;
 
+    uint32_t flags = spin_lock_irqsave(&vmalloc_lock);
+
     if(block_size > vmalloc_totalFreeBlock)
+    {
+        spin_unlock_irqrestore(&vmalloc_lock, flags);
         return NULL;
+    }
     
     index = VMALLOC_firstFreeBlock();
     block_addr = index;
@@ -131,6 +141,7 @@ void* VMALLOC_findFreeRange(uint32_t block_size)
                 vmalloc_totalFreeBlock--;
             }
             
+            spin_unlock_irqrestore(&vmalloc_lock, flags);
             return (void*)((block_addr * BLOCK_SIZE) + VMALLOC_START);
         }
 
@@ -145,15 +156,18 @@ void* VMALLOC_findFreeRange(uint32_t block_size)
         count++;
     }
     
+    spin_unlock_irqrestore(&vmalloc_lock, flags);
     return NULL;
 }
 
-void VMALLOC_freeThisRange(void* ptr, uint8_t size)
+void VMALLOC_freeThisRange(void* ptr, uint32_t size)
 {
     if(!ptr)
         return;
 
-    uint32_t block = (uint32_t)ptr / (BLOCK_SIZE);
+    uint32_t block = ((uint32_t)ptr - VMALLOC_START) / (BLOCK_SIZE);
+
+    uint32_t flags = spin_lock_irqsave(&vmalloc_lock);
 
     for(int i = 0; i < size; i++)
     {
@@ -161,6 +175,87 @@ void VMALLOC_freeThisRange(void* ptr, uint8_t size)
         vmalloc_totalUsedBlock--;
         vmalloc_totalFreeBlock++;
     }
+
+    spin_unlock_irqrestore(&vmalloc_lock, flags);
+}
+
+bool VMALLOC_track(void* block_addr, uint32_t block_size, bool own_frames)
+{
+    tracking_list_t* new = kmalloc(sizeof(tracking_list_t));
+    if(new == NULL)
+        return false;
+
+    new->addr = (uint32_t)block_addr;
+    new->block_size = block_size;
+    new->own_frames = own_frames;
+    new->next = NULL;
+
+    uint32_t flags = spin_lock_irqsave(&vmalloc_lock);
+
+    if(tracking_head == NULL)
+        tracking_head = new;
+    else
+    {
+        new->next = tracking_head->next;
+        tracking_head->next = new;
+    }
+
+    spin_unlock_irqrestore(&vmalloc_lock, flags);
+    return true;
+}
+
+// undo a vmap/ioremap that failed half way: only the first 'mapped' pages are in the page tables
+void VMALLOC_abortMapping(void* block_addr, uint32_t mapped, uint32_t block_size)
+{
+    for(int i = 0; i < mapped; i++)
+        VIRTMEM_unMapPhysPage(block_addr + (BLOCK_SIZE * i));
+
+    VMALLOC_freeThisRange(block_addr, block_size);
+}
+
+// give back a range allocated by vmalloc, vmap or ioremap
+void VMALLOC_release(void* ptr)
+{
+    if(ptr == NULL)
+        return;
+
+    uint32_t flags = spin_lock_irqsave(&vmalloc_lock);
+
+    tracking_list_t *this = tracking_head;
+    tracking_list_t *before_this = NULL;
+    while (this != NULL && this->addr != (uint32_t)ptr)
+    {
+        before_this = this;
+        this = this->next;
+    }
+
+    // if it reaches here that's means we never allocated this pointer before !
+    if(this == NULL)
+    {
+        spin_unlock_irqrestore(&vmalloc_lock, flags);
+        return;
+    }
+
+    if(before_this != NULL)
+        before_this->next = this->next;
+    else
+        tracking_head = this->next;
+
+    spin_unlock_irqrestore(&vmalloc_lock, flags);
+
+    for(int i = 0; i < this->block_size; i++)
+    {
+        if(this->own_frames)
+            VIRTMEM_unMapPage(ptr + (BLOCK_SIZE * i));
+        else
+            VIRTMEM_unMapPhysPage(ptr + (BLOCK_SIZE * i));
+    }
+
+    // the range can only be handed out again once no cpu has it in its tlb
+    SMP_shootdownTlb();
+    VMALLOC_freeThisRange(ptr, this->block_size);
+
+    kfree(this);
 }
 
 //============================================================================
@@ -205,60 +300,118 @@ void* vmalloc(size_t size)
     uint32_t block_size = roundUp_div(size, BLOCK_SIZE);
 
     void* block_addr = VMALLOC_findFreeRange(block_size);
+    if(block_addr == NULL)
+        return NULL;
 
     for(int i = 0; i < block_size; i++)
         VIRTMEM_mapPage (block_addr + (BLOCK_SIZE * i), true);
 
-    tracking_list_t* new = kmalloc(sizeof(tracking_list_t));
+    VMALLOC_track(block_addr, block_size, true);
 
-    new->addr = (uint32_t)block_addr;
-    new->block_size = block_size;
-    new->next = NULL;
+    return block_addr;
+}
 
-    if(tracking_head == NULL)
-        tracking_head = new;
-    else
+void vfree(void* ptr)
+{
+    VMALLOC_release(ptr);
+}
+
+/*
+ * Map caller supplied physical frames (page aligned) into one contiguous kernel range.
+ * The frames are not owned by vmalloc: vunmap only removes the mapping.
+ */
+void* vmap(void** frames, size_t count, uint32_t flags)
+{
+    if(frames == NULL || count == 0)
+        return NULL;
+
+    for(int i = 0; i < count; i++)
     {
-        new->next = tracking_head->next;
-        tracking_head->next = new;
+        if(((uint32_t)frames[i] & (BLOCK_SIZE - 1)) != 0)
+            return NULL;    // not a frame
+    }
+
+    void* block_addr = VMALLOC_findFreeRange(count);
+    if(block_addr == NULL)
+        return NULL;
+
+    flags &= (PTE_PAGE_WRITE | PTE_PAGE_PWT | PTE_PAGE_PCD);   // vmap is kernel only
+
+    for(int i = 0; i < count; i++)
+    {
+        // a page table could not be allocated
+        if(!VIRTMEM_mapPhysPage(block_addr + (BLOCK_SIZE * i), frames[i], flags | PTE_PAGE_KERNEL_MODE))
+        {
+            VMALLOC_abortMapping(block_addr, i, count);
+            return NULL;
+        }
+    }
+
+    if(!VMALLOC_track(block_addr, count, false))
+    {
+        VMALLOC_abortMapping(block_addr, count, count);
+        return NULL;
     }
 
     return block_addr;
 }
 
-void vfree(void* ptr)
+void vunmap(void* addr)
 {
-    if(ptr == NULL || tracking_head == NULL)
-        return;
+    VMALLOC_release(addr);
+}
 
-    tracking_list_t *this = tracking_head;
-    tracking_list_t *before_this = NULL;
-    while (this != NULL)
+/*
+ * Map a physical range (MMIO, framebuffer ...) into kernel space.
+ * The returned pointer keeps the offset of phys inside its page.
+ */
+void* ioremap(uint32_t phys, size_t len, IOREMAP_CACHE_MODE cache_mode)
+{
+    if(len == 0)
+        return NULL;
+
+    uint32_t offset = phys & (BLOCK_SIZE - 1);
+    uint32_t base = phys - offset;
+    uint32_t block_size = roundUp_div(len + offset, BLOCK_SIZE);
+    uint32_t flags = PTE_PAGE_WRITE;
+
+    switch (cache_mode)
     {
-        if(this->addr == (uint32_t)ptr)
+    case IOREMAP_WRITE_THROUGH:
+        flags |= PTE_PAGE_PWT;
+        break;
+
+    case IOREMAP_UNCACHED:
+        flags |= PTE_PAGE_PCD | PTE_PAGE_PWT;
+        break;
+
+    default:
+        break;
+    }
+
+    void* block_addr = VMALLOC_findFreeRange(block_size);
+    if(block_addr == NULL)
+        return NULL;
+
+    for(int i = 0; i < block_size; i++)
+    {
+        if(!VIRTMEM_mapPhysPage(block_addr + (BLOCK_SIZE * i), (void*)(base + (BLOCK_SIZE * i)), flags | PTE_PAGE_KERNEL_MODE))
         {
-            VMALLOC_freeThisRange(ptr, this->block_size);
-            for(int i = 0; i < this->block_size; i++)
-                VIRTMEM_unMapPage(ptr + (BLOCK_SIZE * i));
-            
-            if(before_this != NULL)
-            {
-                before_this->next = this->next;
-                kfree(this);
-                this = NULL;
-            }
-            else
-            {
-                tracking_head = this->next;
-                kfree(this);
-            }
-            
-            return;
+            VMALLOC_abortMapping(block_addr, i, block_size);
+            return NULL;
         }
+    }
 
-        before_this = this;
-        this = this->next;
+    if(!VMALLOC_track(block_addr, block_size, false))
+    {
+        VMALLOC_abortMapping(block_addr, block_size, block_size);
+        return NULL;
     }
 
-    // if it reaches here that's means we never allocated this pointer before !
-}
\ No newline at end of file
+    return block_addr + offset;
+}
+
+void iounmap(void* addr)
+{
+    VMALLOC_release((void*)((uint32_t)addr & ~(BLOCK_SIZE - 1)));
+}
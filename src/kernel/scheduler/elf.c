@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <debug.h>
+#include <memmgr/vma.h>
+#include <scheduler/multitask.h>
+#include <scheduler/elf.h>
+#include <vfs/vfs.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define PAGE_SIZE           0x1000
+#define USER_IMAGE_START    0x400000    // the first 4mb are the kernel's (identity mapped)
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+static bool read_at(int fd, uint32_t offset, void* buffer, size_t size)
+{
+    if(VFS_lseek(fd, offset, VFS_SEEK_SET) < 0)
+        return false;
+
+    return (int)VFS_read(fd, buffer, size) == (int)size;
+}
+
+// a PT_LOAD segment becomes an area, its pages are read on the first access
+static bool add_segment(process_t* proc, int fd, elf32_program_header_t* segment)
+{
+    uint32_t start = segment->vaddr & ~(PAGE_SIZE - 1);
+    uint32_t end = segment->vaddr + segment->memsz;
+    uint32_t shift = segment->vaddr - start;    // same in the file: offset and vaddr are congruent
+
+    if(segment->filesz > segment->memsz || end < segment->vaddr || (segment->offset & (PAGE_SIZE - 1)) != shift)
+        return false;
+
+    if(start < USER_IMAGE_START || end > USER_HEAP_START)
+        return false;   // the heap, mmap and stack areas come after the program
+
+    uint32_t flags = VMA_READ;
+    if(segment->flags & ELF_PF_W)
+        flags |= VMA_WRITE;
+    if(segment->flags & ELF_PF_X)
+        flags |= VMA_EXEC;
+
+    end = (end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    return VMA_add(&proc->vmas, start, end, flags, fd, segment->offset - shift, segment->filesz + shift);
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+/*
+ * Reserve the areas of an ELF32 executable in the process, nothing is read
+ * but the headers. fd must stay open as long as the process lives.
+ */
+int elf_load(process_t* proc, int fd, uint32_t* entry)
+{
+    elf32_header_t header;
+
+    if(!read_at(fd, 0, &header, sizeof(header)) || header.magic != ELF_MAGIC)
+        return ELF_NOT_ELF;
+
+    if(header.class != ELF_CLASS_32 || header.data != ELF_DATA_LSB || header.type != ELF_TYPE_EXEC ||
+       header.machine != ELF_MACHINE_386 || header.phentsize != sizeof(elf32_program_header_t))
+    {
+        log_err("elf", "not an i386 executable");
+        return ELF_INVALID;
+    }
+
+    for(int i = 0; i < header.phnum; i++)
+    {
+        elf32_program_header_t segment;
+
+        if(!read_at(fd, header.phoff + i * sizeof(segment), &segment, sizeof(segment)))
+            return ELF_INVALID;
+
+        if(segment.type != ELF_PT_LOAD || segment.memsz == 0)
+            continue;
+
+        if(!add_segment(proc, fd, &segment))
+        {
+            log_err("elf", "bad segment at %x", segment.vaddr);
+            return ELF_INVALID;
+        }
+    }
+
+    *entry = header.entry;
+    return ELF_OK;
+}
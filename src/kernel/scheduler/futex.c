@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memmgr/virtmem_manager.h>
+#include <scheduler/multitask.h>
+#include <scheduler/waitqueue.h>
+#include <scheduler/futex.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+// tasks sleeping on a futex, hashed by the physical address of the word (zeroed: empty)
+wait_queue_t futex_queues[FUTEX_HASH_SIZE];
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+// physical address: the same word mapped twice (or in two processes) is the same futex
+static uint32_t futex_key(uint32_t* addr)
+{
+    return (uint32_t)VIRTMEM_getPhysAddr(addr) | ((uint32_t)addr & 0xFFF);
+}
+
+static wait_queue_t* futex_queue(uint32_t key)
+{
+    // the low 2 bits are always 0 (aligned words)
+    uint32_t hash = (key >> 2) ^ (key >> 12);
+    return &futex_queues[hash & (FUTEX_HASH_SIZE - 1)];
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+/*
+ * Sleep as long as *addr == val, until futex_wake or 'timeout_ms' (0: no
+ * time out). The test and the block are done with the scheduler locked,
+ * a futex_wake after the user changed the word can't be missed.
+ * addr must be an aligned word mapped in the current address space.
+ */
+int futex_wait(uint32_t* addr, uint32_t val, uint32_t timeout_ms)
+{
+    process_t* proc = get_current_process();
+    uint32_t key = futex_key(addr);
+    wait_queue_t* wq = futex_queue(key);
+
+    lock_sheduler();
+
+    if(*(volatile uint32_t*)addr != val)
+    {
+        unlock_sheduler();
+        return FUTEX_EAGAIN;
+    }
+
+    proc->futex_key = key;
+
+    if(timeout_ms != 0)
+        wait_queue_block_timeout(wq, timeout_ms);
+    else
+        wait_queue_block(wq);
+
+    unlock_sheduler();
+    yield();
+    lock_sheduler();
+
+    bool woken = (proc->futex_key == 0);
+    proc->futex_key = 0;
+    wait_queue_finish(wq);
+
+    unlock_sheduler();
+
+    return woken ? FUTEX_OK : FUTEX_ETIMEDOUT;
+}
+
+// wake up to 'count' tasks waiting on addr, in FIFO order, returns how many were woken
+uint32_t futex_wake(uint32_t* addr, uint32_t count)
+{
+    uint32_t key = futex_key(addr);
+    wait_queue_t* wq = futex_queue(key);
+    uint32_t woken = 0;
+
+    lock_sheduler();
+
+    process_t* proc = wq->first;
+    while(proc != NULL && woken < count)
+    {
+        process_t* next = proc->next;
+
+        // other futexes share the queue
+        if(proc->futex_key == key)
+        {
+            proc->futex_key = 0;
+            wake_up_task_locked(wq, proc);
+            woken++;
+        }
+
+        proc = next;
+    }
+
+    unlock_sheduler();
+    return woken;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <debug.h>
+#include <memory.h>
+#include <hal/syscall.h>
+#include <memmgr/heap.h>
+#include <memmgr/virtmem_manager.h>
+#include <scheduler/multitask.h>
+#include <scheduler/waitqueue.h>
+#include <scheduler/ioring.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define IORING_MASK         (IORING_ENTRIES - 1)
+#define IORING_STACK_SIZE   0x2000  // the vfs and the floppy driver run on it
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+static bool ioring_has_work(ioring_t* ring)
+{
+    if(ring->exiting)
+        return true;
+
+    uint32_t submitted = ring->shared->sq_tail - ring->sq_head;
+    uint32_t unreaped = ring->cq_tail - ring->shared->cq_head;
+
+    // no completion room: wait for the program to reap some
+    return submitted != 0 && unreaped < IORING_ENTRIES;
+}
+
+// same as the syscall, the worker is a thread of the process: same files, same pointer checks
+static int32_t ioring_run(ioring_sqe_t* sqe)
+{
+    switch (sqe->opcode)
+    {
+    case SYSCALL_OPEN:
+        return SYSCALL_dispatch(SYSCALL_OPEN, sqe->arg1, sqe->arg2, 0);
+
+    case SYSCALL_READ:
+    case SYSCALL_WRITE:
+    case SYSCALL_CLOSE:
+    case SYSCALL_LSEEK:
+        return SYSCALL_dispatch(sqe->opcode, sqe->fd, sqe->arg1, sqe->arg2);
+
+    default:
+        return SYSCALL_ENOSYS;
+    }
+}
+
+static void ioring_worker(void* arg)
+{
+    ioring_t* ring = (ioring_t*)arg;
+
+    while(true)
+    {
+        wait_event(&ring->work_wait, ioring_has_work(ring));
+
+        if(ring->exiting)
+            break;
+
+        // a tail more than a ring ahead is garbage, skip what was never valid
+        if(ring->shared->sq_tail - ring->sq_head > IORING_ENTRIES)
+            ring->sq_head = ring->shared->sq_tail - IORING_ENTRIES;
+
+        // copied: the slot belongs to the program again once sq_head moves
+        volatile ioring_sqe_t* slot = &ring->sq[ring->sq_head & IORING_MASK];
+        ioring_sqe_t sqe = {
+            .opcode = slot->opcode,
+            .fd = slot->fd,
+            .arg1 = slot->arg1,
+            .arg2 = slot->arg2,
+            .user_data = slot->user_data,
+        };
+
+        ring->sq_head++;
+        ring->shared->sq_head = ring->sq_head;
+
+        int32_t result = ioring_run(&sqe);
+
+        volatile ioring_cqe_t* cqe = &ring->cq[ring->cq_tail & IORING_MASK];
+        cqe->user_data = sqe.user_data;
+        cqe->result = result;
+
+        // published after the entry (volatile stores stay in order, x86 doesn't reorder them)
+        ring->cq_tail++;
+        ring->shared->cq_tail = ring->cq_tail;
+
+        wake_up_all(&ring->completion_wait);
+    }
+
+    kfree(ring);
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+// map the ring page in the current address space and start its worker
+bool ioring_setup(process_t* owner)
+{
+    if(owner->ioring != NULL)
+        return true;    // one ring per process
+
+    if(!VIRTMEM_mapPage((void*)IORING_PAGE, false))
+        return false;
+
+    memset((void*)IORING_PAGE, 0, 0x1000);
+
+    ioring_t* ring = kmalloc(sizeof(ioring_t));
+    if(ring == NULL)
+    {
+        VIRTMEM_unMapPage((void*)IORING_PAGE);
+        return false;
+    }
+
+    ring->shared = (ioring_shared_t*)IORING_PAGE;
+    ring->sq = (ioring_sqe_t*)(IORING_PAGE + IORING_SQ_OFFSET);
+    ring->cq = (ioring_cqe_t*)(IORING_PAGE + IORING_CQ_OFFSET);
+    ring->sq_head = 0;
+    ring->cq_tail = 0;
+    ring->exiting = false;
+    wait_queue_init(&ring->work_wait);
+    wait_queue_init(&ring->completion_wait);
+
+    ring->shared->entries = IORING_ENTRIES;
+
+    owner->ioring = ring;
+
+    ring->worker = create_thread(ioring_worker, ring, IORING_STACK_SIZE);
+    if(ring->worker == NULL)
+    {
+        owner->ioring = NULL;
+        kfree(ring);
+        VIRTMEM_unMapPage((void*)IORING_PAGE);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Kick the worker for the new submissions and wait for 'min_complete'
+ * completions to reap (at most a full ring). Returns the completions
+ * ready, -1 if the process has no ring.
+ */
+int ioring_enter(process_t* owner, uint32_t min_complete)
+{
+    ioring_t* ring = owner->ioring;
+    if(ring == NULL)
+        return -1;
+
+    wake_up_one(&ring->work_wait);
+
+    if(min_complete > IORING_ENTRIES)
+        min_complete = IORING_ENTRIES;
+
+    wait_event(&ring->completion_wait, ring->cq_tail - ring->shared->cq_head >= min_complete);
+
+    return ring->cq_tail - ring->shared->cq_head;
+}
+
+// the process exits, its worker stops after the request in progress and frees the ring
+void ioring_exit(process_t* owner)
+{
+    ioring_t* ring = owner->ioring;
+    if(ring == NULL)
+        return;
+
+    owner->ioring = NULL;
+
+    lock_sheduler();
+    ring->exiting = true;
+    unlock_sheduler();
+
+    wake_up_one(&ring->work_wait);
+}
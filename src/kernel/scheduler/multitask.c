@@ -27,57 +27,227 @@
 #include <memmgr/virtmem_manager.h>
 #include <memory.h>
 #include <hal/gdt.h>
+#include <hal/isr.h>
+#include <hal/fpu.h>
+#include <hal/lapic.h>
+#include <hal/smp.h>
+#include <hal/userinfo.h>
 #include <vfs/vfs.h>
 #include <scheduler/usermode.h>
 #include <scheduler/multitask.h>
+#include <scheduler/timer.h>
+#include <scheduler/waitqueue.h>
+#include <scheduler/workqueue.h>
+#include <scheduler/elf.h>
+#include <scheduler/ioring.h>
+#include <scheduler/spinlock.h>
+#include <trace.h>
 
 uint64_t pids = 0;
 
-process_t* idle;
 process_t* cleaner_process;
 
-// ready list
-process_t* first_READY_process = NULL;
-process_t* last_READY_process = NULL;
+// every cpu has its own run queue, current and idle task
+cpu_t cpus[SMP_MAX_CPUS];
 
-process_t* current_process;
+// one lock for the whole scheduler state (run queues, wait queues, mutexes, timers)
+spinlock_t sched_lock = SPINLOCK_INIT;
+
+#define this_cpu()          (&cpus[SMP_getCpuIndex()])
+#define current_process     (this_cpu()->current)   // only stable with interrupts disabled
 
 // dead list
 process_t* first_DEAD_process = NULL;
 process_t* last_DEAD_process = NULL;
 
-uint32_t disable_irq_count = 0;
+// every process that isn't deleted yet, for the statistics
+process_t* first_process = NULL;
+
+// recycled processes (LIFO, the last freed stack is the most likely in cache)
+process_t* process_pool[PROCESS_POOL_SIZE];
+uint32_t process_pool_count = 0;
+
+sched_stats_t sched_stats;
+bool tickless_idle = true;
+uint64_t next_boost_tick = MLFQ_BOOST_PERIOD;
 
+wait_queue_t cleaner_queue;     // the cleaner waits here for dead processes
+
+mutex_t* first_mutex = NULL;    // every mutex used at least once
+
+/*
+ * Interrupts are disabled on the local cpu and the scheduler spinlock keeps
+ * the other cpus out. The lock can be taken again by the cpu that holds it,
+ * and it stays held across context_switch: the next task releases it.
+ */
 void lock_sheduler()
 {
     disableInterrupts();
-    disable_irq_count++;
+
+    cpu_t* cpu = this_cpu();
+    if(cpu->lock_depth++ == 0)
+        spin_lock(&sched_lock);
 }
 
 void unlock_sheduler()
 {
-    if(disable_irq_count <= 0)
+    cpu_t* cpu = this_cpu();
+
+    if(cpu->lock_depth <= 0)
         return;
 
-    disable_irq_count--;
+    cpu->lock_depth--;
 
-    if(disable_irq_count == 0)
+    if(cpu->lock_depth == 0)
+    {
+        spin_unlock(&sched_lock);
         enableInterrupts();
+    }
+}
+
+static uint32_t mlfq_quantum(uint8_t level)
+{
+    return MLFQ_BASE_QUANTUM << (level / MLFQ_LEVELS_PER_STEP);
+}
+
+// charge the time spent in the old status before switching to the new one
+static void set_status(process_t* proc, status_t status)
+{
+    uint64_t now = getTickCount();
+    uint64_t elapsed = now - proc->state_tick;
+
+    switch(proc->status)
+    {
+    case RUNNING:   proc->cpu_ticks += elapsed;     break;
+    case READY:     proc->ready_ticks += elapsed;   break;
+    case BLOCKED:   proc->blocked_ticks += elapsed; break;
+    default:                                        break;
+    }
+
+    proc->status = status;
+    proc->state_tick = now;
+}
+
+static void sleep_timeout(void* arg);
+
+static void init_task_state(process_t* proc, status_t status)
+{
+    timer_init(&proc->sleep_timer, sleep_timeout, proc);
+    proc->waiting_on = NULL;
+    proc->futex_key = 0;
+    proc->blocked_on = NULL;
+    proc->held_mutexes = NULL;
+    proc->pi_boosted = false;
+
+    proc->status = status;
+    proc->state_tick = getTickCount();
+    proc->cpu_ticks = 0;
+    proc->ready_ticks = 0;
+    proc->blocked_ticks = 0;
+    proc->voluntary_switches = 0;
+    proc->involuntary_switches = 0;
+
+    proc->fpu_state = FPU_ALIGN_STATE(proc->fpu_buffer);
+    FPU_initState(proc->fpu_state);
+
+    lock_sheduler();
+
+    proc->all_prev = NULL;
+    proc->all_next = first_process;
+
+    if(first_process != NULL)
+        first_process->all_prev = proc;
+
+    first_process = proc;
+
+    unlock_sheduler();
 }
 
+static void record_wake_latency(uint64_t latency)
+{
+    uint32_t bucket = 0;
+
+    while(latency != 0 && bucket < SCHED_LATENCY_BUCKETS - 1)
+    {
+        latency >>= 1;
+        bucket++;
+    }
+
+    sched_stats.wake_latency_hist[bucket]++;
+}
+
+// queued on the run queue of proc->cpu
 void add_READY_process(process_t* proc)
 {
     lock_sheduler();
 
-    if(first_READY_process == NULL)
-        first_READY_process = proc;
-    
-    if(last_READY_process != NULL)
-        last_READY_process->next = proc;
+    cpu_t* rq = &cpus[proc->cpu];
+    uint8_t level = proc->priority;
 
-    last_READY_process = proc;
-    last_READY_process->status = READY;
-    last_READY_process->next = NULL;
+    set_status(proc, READY);
+    proc->next = NULL;
+    proc->prev = rq->last_ready[level];
+
+    if(rq->last_ready[level] != NULL)
+        rq->last_ready[level]->next = proc;
+    else
+        rq->first_ready[level] = proc;
+
+    rq->last_ready[level] = proc;
+    rq->ready_bitmap |= (1u << level);
+    rq->ready_count++;
+
+    unlock_sheduler();
+}
+
+// add it to the front of its level so it can be executed right away
+void push_READY_process(process_t* proc)
+{
+    lock_sheduler();
+
+    cpu_t* rq = &cpus[proc->cpu];
+    uint8_t level = proc->priority;
+
+    set_status(proc, READY);
+    proc->prev = NULL;
+    proc->next = rq->first_ready[level];
+
+    if(rq->first_ready[level] != NULL)
+        rq->first_ready[level]->prev = proc;
+    else
+        rq->last_ready[level] = proc;
+
+    rq->first_ready[level] = proc;
+    rq->ready_bitmap |= (1u << level);
+    rq->ready_count++;
+
+    unlock_sheduler();
+}
+
+void remove_READY_process(process_t* proc)
+{
+    lock_sheduler();
+
+    cpu_t* rq = &cpus[proc->cpu];
+    uint8_t level = proc->priority;
+
+    if(proc->prev != NULL)
+        proc->prev->next = proc->next;
+    else
+        rq->first_ready[level] = proc->next;
+
+    if(proc->next != NULL)
+        proc->next->prev = proc->prev;
+    else
+        rq->last_ready[level] = proc->prev;
+
+    if(rq->first_ready[level] == NULL)
+        rq->ready_bitmap &= ~(1u << level);
+
+    rq->ready_count--;
+
+    proc->next = NULL;
+    proc->prev = NULL;
 
     unlock_sheduler();
 }
@@ -93,70 +263,334 @@ void add_DEAD_process(process_t* proc)
         last_DEAD_process->next = proc;
 
     last_DEAD_process = proc;
-    last_DEAD_process->status = DEAD;
+    set_status(last_DEAD_process, DEAD);
     last_DEAD_process->next = NULL;
 
     unlock_sheduler();
 }
 
+static bool is_idle_task(process_t* proc)
+{
+    return proc == cpus[proc->cpu].idle;
+}
+
+static bool cpu_is_idle(cpu_t* cpu)
+{
+    return cpu->current == cpu->idle;
+}
+
+// the least loaded online cpu, for a new task
+static int select_cpu()
+{
+    int best = 0;
+    uint32_t best_load = 0xFFFFFFFF;
+
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+    {
+        if(!cpus[i].online)
+            continue;
+
+        uint32_t load = cpus[i].ready_count + (cpu_is_idle(&cpus[i]) ? 0 : 1);
+        if(load < best_load)
+        {
+            best = i;
+            best_load = load;
+        }
+    }
+
+    return best;
+}
+
+// a woken task goes back where its cache is warm, unless that cpu is busy and another one idles
+static int select_wake_cpu(process_t* proc)
+{
+    if(proc->on_cpu || cpu_is_idle(&cpus[proc->cpu]))
+        return proc->cpu;
+
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+    {
+        if(cpus[i].online && cpu_is_idle(&cpus[i]) && cpus[i].ready_count == 0)
+            return i;
+    }
+
+    return proc->cpu;
+}
+
+// tell a cpu that a task of the given level was queued on it
+static void kick_cpu(cpu_t* cpu, uint8_t priority)
+{
+    if(cpu_is_idle(cpu) || priority < cpu->current->priority)
+    {
+        if(cpu == this_cpu())
+            cpu->need_resched = true;
+        else
+            SMP_sendIpi(cpu->id, IPI_RESCHEDULE_VECTOR);
+    }
+}
+
+// work is waiting in a busy run queue: wake an idle cpu so it steals it
+static void kick_idle_cpu()
+{
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+    {
+        if(cpus[i].online && cpu_is_idle(&cpus[i]) && cpus[i].ready_count == 0 && &cpus[i] != this_cpu())
+        {
+            SMP_sendIpi(i, IPI_RESCHEDULE_VECTOR);
+            return;
+        }
+    }
+}
+
+// first task of the highest non-empty level that no other cpu is still switching away from
+static process_t* pick_ready(cpu_t* cpu, process_t* prev)
+{
+    uint32_t bitmap = cpu->ready_bitmap;
+
+    while(bitmap != 0)
+    {
+        // the lowest set bit is the highest non-empty priority level (bsf)
+        int level = __builtin_ctz(bitmap);
+
+        for(process_t* proc = cpu->first_ready[level]; proc != NULL; proc = proc->next)
+        {
+            if(!proc->on_cpu || proc == prev)
+                return proc;
+        }
+
+        bitmap &= ~(1u << level);
+    }
+
+    return NULL;
+}
+
+static bool can_steal(cpu_t* cpu)
+{
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+    {
+        if(&cpus[i] != cpu && cpus[i].online && cpus[i].ready_count > 0)
+            return true;
+    }
+
+    return false;
+}
+
+// an idle cpu takes a task from the busiest run queue
+static process_t* steal_task(cpu_t* cpu)
+{
+    cpu_t* victim = NULL;
+
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+    {
+        if(&cpus[i] == cpu || !cpus[i].online || cpus[i].ready_count == 0)
+            continue;
+
+        if(victim == NULL || cpus[i].ready_count > victim->ready_count)
+            victim = &cpus[i];
+    }
+
+    if(victim == NULL)
+        return NULL;
+
+    process_t* proc = pick_ready(victim, NULL);
+    if(proc == NULL)
+        return NULL;
+
+    remove_READY_process(proc);
+    proc->cpu = cpu->id;
+    add_READY_process(proc);
+
+    cpu->steals++;
+    return proc;
+}
+
 process_t* schedule_next_process()
 {
     lock_sheduler();    // dont forget to unlock   
 
-    if(current_process->status == RUNNING && current_process != idle)
+    cpu_t* cpu = this_cpu();
+    process_t* prev = cpu->current;
+    process_t* next;
+
+    if(prev->status == RUNNING && prev != cpu->idle)
+        add_READY_process(prev); // never add the idle or blocked and dead task
+
+    next = pick_ready(cpu, prev);
+
+    if(next == NULL)
+        next = steal_task(cpu);
+
+    if(next == NULL)
     {
-        add_READY_process(current_process); // never add the idle or blocked and dead task
+        cpu->current = cpu->idle;
+        set_status(cpu->idle, RUNNING);
+        unlock_sheduler();
+        return cpu->idle;
     }
-        
 
-    if(first_READY_process == NULL)
+    if(prev == cpu->idle)
     {
-        current_process = idle;
-        current_process->status = RUNNING;
-        unlock_sheduler();
-        return current_process;
+        set_status(cpu->idle, READY);    // not queued, only so the idle time isn't charged as cpu time
+
+        if(cpu->id != 0)
+        {
+            PIT_startCpuTick();     // stopped by idle_loop
+
+            // the boot cpu may sleep in tickless mode, it must run the kernel timers of this cpu
+            if(cpu_is_idle(&cpus[0]))
+                SMP_sendIpi(0, IPI_RESCHEDULE_VECTOR);
+        }
     }
-    
-    current_process = first_READY_process;
-    current_process->status = RUNNING;
 
-    if(first_READY_process == last_READY_process)
+    remove_READY_process(next);
+    set_status(next, RUNNING);
+    next->on_cpu = true;
+    cpu->current = next;
+
+    if(next->time_slice == 0)
+        next->time_slice = mlfq_quantum(next->priority);
+
+    if(next->wake_tick != 0)
     {
-        first_READY_process = NULL;
-        last_READY_process = NULL;
-        unlock_sheduler();
-        return current_process;
+        uint64_t latency = getTickCount() - next->wake_tick;
+
+        sched_stats.wakeups++;
+        sched_stats.wake_latency_ticks += latency;
+        record_wake_latency(latency);
+        next->wake_tick = 0;
     }
 
-    first_READY_process = first_READY_process->next;
+    if(cpu->ready_count > 0)
+        kick_idle_cpu();
+
     unlock_sheduler();
-    return current_process;
-    
+    return next;
+}
+
+/*
+ * Runs on the new task right after context_switch, still locked. Until
+ * then the previous task was using its stack: only now can another cpu
+ * run it, or the cleaner free it.
+ */
+static void finish_task_switch()
+{
+    cpu_t* cpu = this_cpu();
+    process_t* prev = cpu->prev;
+
+    prev->on_cpu = false;
+
+    if(prev->status == DEAD)
+    {
+        add_DEAD_process(prev);
+        wake_up_one(&cleaner_queue);
+    }
+    else if(prev->status == READY && prev->cpu != cpu->id)
+        kick_cpu(&cpus[prev->cpu], prev->priority);   // woken up on another cpu while it was leaving this one
+}
+
+/*
+ * Lazy FPU switching: the next task runs with CR0.TS set and traps (#NM)
+ * on its first FPU instruction, fpu_trap moves the state then. With more
+ * than one cpu a task that used the FPU is saved when it is switched out:
+ * it may run on another cpu before this one traps again.
+ */
+static void fpu_switch(cpu_t* cpu, process_t* prev, process_t* next)
+{
+    if(cpu->fpu_owner == prev && (prev->status == DEAD || SMP_getCpuCount() > 1))
+    {
+        if(prev->status != DEAD)
+        {
+            FPU_clearTaskSwitched();    // fxsave would trap too
+            FPU_save(prev->fpu_state);
+        }
+
+        cpu->fpu_owner = NULL;
+    }
+
+    if(cpu->fpu_owner == next)
+        FPU_clearTaskSwitched();    // its registers are still loaded, no trap needed
+    else
+        FPU_setTaskSwitched();
+}
+
+// the current task touched the FPU while another task's state is loaded
+static void fpu_trap(Registers* regs)
+{
+    cpu_t* cpu = this_cpu();
+    process_t* proc = cpu->current;
+
+    FPU_clearTaskSwitched();
+
+    if(cpu->fpu_owner == proc)
+        return;
+
+    if(cpu->fpu_owner != NULL)
+        FPU_save(cpu->fpu_owner->fpu_state);
+
+    FPU_restore(proc->fpu_state);
+    cpu->fpu_owner = proc;
+    cpu->fpu_loads++;
 }
 
 void yield()
 {
     lock_sheduler();
 
-    process_t* prev = current_process;
+    cpu_t* cpu = this_cpu();
+    cpu->need_resched = false;
+
+    process_t* prev = cpu->current;
+    bool preempted = (prev->status == RUNNING);   // still runnable, it didn't block itself
     process_t* next = schedule_next_process();
 
     if(prev != next)
     {   
+        sched_stats.context_switches++;
+        cpu->context_switches++;
+
+        if(preempted)
+            prev->involuntary_switches++;
+        else
+            prev->voluntary_switches++;
+
         if(next->user)    // if it's a usermode process
-            TSS_setKernelStack((uint32_t)next->stack + 0x1000);
+            TSS_setKernelStack((uint32_t)next->stack + next->stack_size);
+
+        fpu_switch(cpu, prev, next);
 
+        cpu->prev = prev;
+        trace(TRACE_SWITCH, prev->id, next->id);
         context_switch(prev, next);
+
+        finish_task_switch();   // maybe on another cpu than the one it left
     }
 
     unlock_sheduler();
 }
 
+process_t* get_current_process()
+{
+    // no migration between reading the cpu index and its current task
+    uint32_t flags = disableInterruptsSave();
+    process_t* proc = current_process;
+    restoreInterrupts(flags);
+
+    return proc;
+}
+
 void block_current_task()
 {
     lock_sheduler();
 
-    current_process->status = BLOCKED;
+    set_status(current_process, BLOCKED);
+
+    // it gave the cpu back before the end of its quantum, it's interactive
+    if(current_process->time_slice > 0 && current_process->priority > current_process->base_priority)
+    {
+        current_process->priority--;
+        sched_stats.promotions++;
+    }
+
+    current_process->time_slice = 0;    // fresh quantum when it runs again
 
     unlock_sheduler();
 }
@@ -165,60 +599,451 @@ void unblock_task(process_t* proc)
 {
     lock_sheduler();
 
-    // add it to the front list so it can be executed right away
-    proc->next = first_READY_process;
-    first_READY_process = proc;
-    first_READY_process->status = READY;
+    proc->wake_tick = getTickCount();
+    proc->cpu = select_wake_cpu(proc);
+    push_READY_process(proc);
 
-    if(last_READY_process == NULL)
-        last_READY_process = first_READY_process;
+    kick_cpu(&cpus[proc->cpu], proc->priority);
 
     unlock_sheduler();
 }
 
+// put every ready task back to its base level so nobody starves
+static void mlfq_boost()
+{
+    process_t* proc;
+    process_t* next;
+
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+    {
+        cpu_t* cpu = &cpus[i];
+
+        if(!cpu->online)
+            continue;
+
+        for(int level = 0; level < PRIORITY_LEVELS; level++)
+        {
+            proc = cpu->first_ready[level];
+            while(proc != NULL)
+            {
+                next = proc->next;
+                if(proc->priority != proc->base_priority && !proc->pi_boosted)
+                {
+                    remove_READY_process(proc);
+                    proc->priority = proc->base_priority;
+                    proc->time_slice = 0;
+                    add_READY_process(proc);
+                }
+                proc = next;
+            }
+        }
+
+        if(!cpu_is_idle(cpu) && !cpu->current->pi_boosted)
+            cpu->current->priority = cpu->current->base_priority;
+    }
+
+    sched_stats.boosts++;
+}
+
+// called by the timer irq on every tick, it only decides: the switch
+// itself is done by scheduler_irq_exit once the handler is finished.
+// Without local apic timers only the boot cpu gets the PIT, it forwards
+// the tick to the busy cpus.
+void scheduler_tick()
+{
+    lock_sheduler();
+
+    cpu_t* cpu = this_cpu();
+
+    if(cpu->id == 0)
+    {
+        for(int i = 1; i < SMP_MAX_CPUS && !PIT_usesLapicTimer(); i++)
+        {
+            if(cpus[i].online && !cpu_is_idle(&cpus[i]))
+                SMP_sendIpi(i, IPI_TICK_VECTOR);
+        }
+
+        if(getTickCount() >= next_boost_tick)
+        {
+            next_boost_tick = getTickCount() + MLFQ_BOOST_PERIOD;
+            mlfq_boost();
+        }
+    }
+
+    if(cpu_is_idle(cpu))
+    {
+        if(cpu->ready_bitmap != 0 || can_steal(cpu))
+            cpu->need_resched = true;
+        unlock_sheduler();
+        return;
+    }
+
+    if(current_process->time_slice > 0)
+        current_process->time_slice--;
+
+    if(current_process->time_slice == 0)
+    {
+        // used the whole quantum: cpu bound, demote it (longer slice, lower level)
+        // unless it runs at an inherited priority, waiters depend on it
+        if(current_process->priority < PRIORITY_LOWEST && !current_process->pi_boosted)
+            current_process->priority++;
+
+        sched_stats.demotions++;
+        sched_stats.preemptions++;
+        cpu->need_resched = true;
+        unlock_sheduler();
+        return;
+    }
+
+    // a higher level task woke up, don't let it wait for the end of our slice
+    if(cpu->ready_bitmap != 0 && __builtin_ctz(cpu->ready_bitmap) < current_process->priority)
+    {
+        sched_stats.preemptions++;
+        cpu->need_resched = true;
+    }
+
+    unlock_sheduler();
+}
+
+// called on the way out of every irq handler
+void scheduler_irq_exit()
+{
+    if(this_cpu()->need_resched)
+        yield();
+}
+
+static void reschedule_ipi(Registers* regs)
+{
+    LAPIC_sendEndOfInterrupt();
+
+    if(!is_multitaskingEnabled())
+        return;
+
+    lock_sheduler();
+
+    // the sender only asks, this cpu checks its own run queue
+    cpu_t* cpu = this_cpu();
+    process_t* proc = pick_ready(cpu, cpu->current);
+
+    if(cpu_is_idle(cpu) || (proc != NULL && proc->priority < cpu->current->priority))
+        cpu->need_resched = true;
+
+    unlock_sheduler();
+    scheduler_irq_exit();
+}
+
+static void tick_ipi(Registers* regs)
+{
+    LAPIC_sendEndOfInterrupt();
+
+    if(!is_multitaskingEnabled())
+        return;
+
+    scheduler_tick();
+    scheduler_irq_exit();
+}
+
+static bool all_cpus_idle()
+{
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+    {
+        if(cpus[i].online && (!cpu_is_idle(&cpus[i]) || cpus[i].ready_count != 0))
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * Body of the idle task. When nothing is runnable the periodic tick is
+ * replaced by a one-shot interrupt at the next timer deadline, so an
+ * idle cpu doesn't wake up a thousand times per second. The PIT belongs
+ * to the boot cpu: it only goes tickless when every cpu is idle.
+ */
+void idle_loop()
+{
+    for(;;)
+    {
+        disableInterrupts();
+
+        cpu_t* cpu = this_cpu();
+
+        if(cpu->id == 0 && tickless_idle && is_multitaskingEnabled())
+        {
+            lock_sheduler();
+            bool idle = all_cpus_idle();
+            unlock_sheduler();
+
+            disableInterrupts();    // unlock_sheduler enabled them
+
+            if(idle && PIT_startOneShot(timer_next_event(PIT_maxOneShotTicks())) != 0)
+                sched_stats.tickless_entries++;
+        }
+
+        // the other cpus only tick for their time slices, an ipi wakes them up for new work
+        // and schedule_next_process restarts the tick
+        if(cpu->id != 0 && tickless_idle && cpu->ready_count == 0)
+            PIT_stopCpuTick();
+
+        enableInterruptsAndHLT();
+
+        disableInterrupts();
+
+        if(cpu->id == 0)
+            PIT_stopOneShot();  // something else woke us up, periodic ticks again
+
+        cpu->idle_wakeups++;
+        enableInterrupts();
+    }
+}
+
+void set_tickless_idle(bool enable)
+{
+    tickless_idle = enable;
+}
+
+void get_scheduler_stats(sched_stats_t* stats)
+{
+    lock_sheduler();
+
+    *stats = sched_stats;
+    stats->idle_wakeups = 0;
+    stats->steals = 0;
+    stats->fpu_loads = 0;
+
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+    {
+        stats->idle_wakeups += cpus[i].idle_wakeups;
+        stats->steals += cpus[i].steals;
+        stats->fpu_loads += cpus[i].fpu_loads;
+    }
+
+    unlock_sheduler();
+}
+
+// copy the state of up to max_count cpus, returns how many are online
+int get_cpu_info(cpu_info_t* info, int max_count)
+{
+    int count = 0;
+
+    lock_sheduler();
+
+    for(int i = 0; i < SMP_MAX_CPUS && count < max_count; i++)
+    {
+        cpu_t* cpu = &cpus[i];
+
+        if(!cpu->online)
+            continue;
+
+        info[count].id = cpu->id;
+        info[count].online = cpu->online;
+        info[count].current = cpu_is_idle(cpu) ? -1 : (int)cpu->current->id;
+        info[count].ready_count = cpu->ready_count;
+        info[count].context_switches = cpu->context_switches;
+        info[count].steals = cpu->steals;
+        info[count].idle_wakeups = cpu->idle_wakeups;
+
+        count++;
+    }
+
+    unlock_sheduler();
+    return count;
+}
+
+// copy the accounting of up to max_count processes, returns how many were copied
+int get_process_info(process_info_t* info, int max_count)
+{
+    int count = 0;
+    uint64_t now;
+
+    lock_sheduler();
+
+    now = getTickCount();
+
+    for(process_t* proc = first_process; proc != NULL && count < max_count; proc = proc->all_next)
+    {
+        info[count].id = proc->id;
+        info[count].user = proc->user;
+        info[count].status = proc->status;
+        info[count].priority = proc->priority;
+        info[count].base_priority = proc->base_priority;
+        info[count].cpu_ticks = proc->cpu_ticks;
+        info[count].ready_ticks = proc->ready_ticks;
+        info[count].blocked_ticks = proc->blocked_ticks;
+        info[count].voluntary_switches = proc->voluntary_switches;
+        info[count].involuntary_switches = proc->involuntary_switches;
+
+        // the current status isn't charged yet
+        switch(proc->status)
+        {
+        case RUNNING:   info[count].cpu_ticks += now - proc->state_tick;     break;
+        case READY:     info[count].ready_ticks += now - proc->state_tick;   break;
+        case BLOCKED:   info[count].blocked_ticks += now - proc->state_tick; break;
+        default:                                                             break;
+        }
+
+        count++;
+    }
+
+    unlock_sheduler();
+    return count;
+}
+
+// change the current level of a task, moving it to the right ready queue if needed
+static void change_priority(process_t* proc, uint8_t priority)
+{
+    lock_sheduler();
+
+    if(proc->status == READY && !is_idle_task(proc))
+    {
+        // move it to the queue of its new level
+        remove_READY_process(proc);
+        proc->priority = priority;
+        add_READY_process(proc);
+    }
+    else
+        proc->priority = priority;
+
+    unlock_sheduler();
+}
+
+void setpriority(process_t* proc, uint8_t priority)
+{
+    if(priority > PRIORITY_LOWEST)
+        priority = PRIORITY_LOWEST;
+
+    lock_sheduler();
+
+    proc->base_priority = priority;
+
+    // a boosted mutex owner keeps its inherited level until it releases the mutex
+    if(proc->pi_boosted && proc->priority < priority)
+        proc->pi_saved_priority = priority;
+    else
+    {
+        proc->pi_boosted = false;
+        change_priority(proc, priority);
+    }
+
+    unlock_sheduler();
+}
+
+uint8_t getpriority(process_t* proc)
+{
+    return proc->priority;
+}
+
 void spawn_process()
 {
+    finish_task_switch();
     unlock_sheduler();
 
-    if(current_process->user)
-    {
-        // assume we have received a path string of a file
-        char* path = (char*)(*(uint32_t*)(current_process->esp + (4 * 6)));
-        int fd1 = VFS_open(path, VFS_O_RDWR);
+    // read once: the task may migrate to another cpu from here on
+    process_t* proc = get_current_process();
+
+    if(proc->user)
+    {
+        // assume we have received a path string of a file
+        char* path = (char*)(*(uint32_t*)(proc->esp + (4 * 6)));
+        int fd1 = VFS_open(path, VFS_O_RDONLY);
+
+        if(fd1 < 0)
+        {
+            log_err("spawn_process", "failed to open the file");
+            terminate_task();
+            return;
+        }
+
+        uint32_t entry;
+        int status = elf_load(proc, fd1, &entry);
 
-        if(fd1 < 0)
+        if(status == ELF_OK)
         {
-            log_err("spawn_process", "failed to open the file");
+            // nothing is loaded yet, the segments and the stack come in on the first faults
+            proc->exec_fd = fd1;
+            VMA_add(&proc->vmas, USER_STACK_TOP - USER_STACK_SIZE, USER_STACK_TOP, VMA_READ | VMA_WRITE, -1, 0, 0);
+
+            USERINFO_mapPages(proc->id);
+            switch_to_usermode(USER_STACK_TOP, entry);
+        }
+
+        if(status == ELF_INVALID)
+        {
+            VFS_close(fd1);
             terminate_task();
             return;
         }
 
+        // flat binary: one page, its stack at the end
+        VFS_lseek(fd1, 0, VFS_SEEK_SET);
         VIRTMEM_mapPage ((void*)0x400000, false);
 
         VFS_read(fd1, (void*)0x400000, 4095);
         VFS_close(fd1);
 
+        USERINFO_mapPages(proc->id);
+
         switch_to_usermode(0x400000+4095, 0x400000);
     }
     else
     {
         // assume we have received a pointer to the entry point of the process
-        void (*task)(void) = (void*)(*(uint32_t*)(current_process->esp + (4 * 6)));
+        void (*task)(void) = (void*)(*(uint32_t*)(proc->esp + (4 * 6)));
         task();
     }
 }
 
-void create_process(void* task, bool is_user)
+// take a process from the pool, its stack and cleared page directory are kept
+static process_t* pool_get()
 {
-    process_t* proc = kmalloc(sizeof(process_t));
+    process_t* proc = NULL;
+
+    lock_sheduler();
+
+    if(process_pool_count > 0)
+        proc = process_pool[--process_pool_count];
+
+    unlock_sheduler();
+    return proc;
+}
 
-    uint32_t* pdbr = getPDBR();
-    proc->virt_pdbr_addr = VIRTMEM_createAddressSpace();
-    proc->phys_pdbr_addr = VIRTMEM_getPhysAddr(proc->virt_pdbr_addr);
+static bool pool_put(process_t* proc)
+{
+    bool stored = false;
+
+    lock_sheduler();
+
+    if(process_pool_count < PROCESS_POOL_SIZE)
+    {
+        process_pool[process_pool_count++] = proc;
+        stored = true;
+    }
+
+    unlock_sheduler();
+    return stored;
+}
+
+process_t* create_process(void* task, bool is_user)
+{
+    process_t* proc = pool_get();
+
+    if(proc != NULL)
+    {
+        VIRTMEM_refreshKernelSpace(proc->virt_pdbr_addr);
+        sched_stats.pool_hits++;
+    }
+    else
+    {
+        proc = kmalloc(sizeof(process_t));
 
-    proc->stack = vmalloc(1);
+        proc->virt_pdbr_addr = VIRTMEM_createAddressSpace();
+        proc->phys_pdbr_addr = VIRTMEM_getPhysAddr(proc->virt_pdbr_addr);
+        proc->stack = vmalloc(PROCESS_STACK_SIZE);
+        proc->stack_size = PROCESS_STACK_SIZE;
+        sched_stats.pool_misses++;
+    }
 
-    proc->esp = proc->stack + 0x1000 - 4;
+    proc->esp = proc->stack + proc->stack_size - 4;
     *(uint32_t*)proc->esp = (uint32_t)task; // argument for spawn_process
 
     proc->esp -= 4;
@@ -229,16 +1054,140 @@ void create_process(void* task, bool is_user)
     
     proc->id = pids++;
     proc->user = is_user;
-    proc->status = READY;
+    init_task_state(proc, READY);
+    proc->priority = PRIORITY_DEFAULT;
+    proc->base_priority = PRIORITY_DEFAULT;
+    proc->time_slice = 0;
+    proc->wake_tick = 0;
+    proc->leader = NULL;
+    proc->address_space_refs = 1;
+    proc->thread_fn = NULL;
+    proc->thread_arg = NULL;
     proc->next = NULL;
+    proc->prev = NULL;
+    proc->on_cpu = false;
+
+    for(int i = 0; i < PROCESS_MAX_FILES; i++)
+        proc->files[i] = VFS_EBADF;
+
+    proc->brk = USER_HEAP_START;
+    proc->mmap_next = USER_MMAP_START;
+    proc->ioring = NULL;
+    VMA_initSpace(&proc->vmas);
+    proc->exec_fd = VFS_EBADF;
+
+    lock_sheduler();
 
+    proc->cpu = select_cpu();
     add_READY_process(proc);
+    kick_cpu(&cpus[proc->cpu], proc->priority);
+
+    unlock_sheduler();
+
+    return proc;
 }
 
-void delete_process(process_t* proc)
+void thread_entry()
+{
+    finish_task_switch();
+    unlock_sheduler();  // because it's the first time
+
+    process_t* proc = get_current_process();
+
+    proc->thread_fn(proc->thread_arg);
+    terminate_task();
+}
+
+/*
+ * Create a kernel thread in the address space of the calling process. No
+ * page directory is built and switching between threads of the same
+ * process doesn't reload CR3. stack_size is rounded up to whole pages.
+ */
+process_t* create_thread(void (*fn)(void*), void* arg, size_t stack_size)
+{
+    if(stack_size < THREAD_MIN_STACK_SIZE)
+        stack_size = THREAD_MIN_STACK_SIZE;
+
+    stack_size = (stack_size + 0xFFF) & ~0xFFF;
+
+    process_t* proc = kmalloc(sizeof(process_t));
+    if(proc == NULL)
+        return NULL;
+
+    proc->stack = vmalloc(stack_size);
+    if(proc->stack == NULL)
+    {
+        log_err("multitask", "no memory for a %d bytes thread stack", stack_size);
+        kfree(proc);
+        return NULL;
+    }
+
+    proc->stack_size = stack_size;
+
+    proc->esp = proc->stack + stack_size - 4;
+    *(uint32_t*)proc->esp = (uint32_t)thread_entry; // return address after context switch
+
+    proc->esp -= (4 * 5);   // pushed register
+    *(uint32_t*)proc->esp = 0x202;       // default eflags for the new thread
+
+    lock_sheduler();
+
+    // a thread created by a thread belongs to the same process
+    process_t* leader = current_process->leader != NULL ? current_process->leader : current_process;
+    leader->address_space_refs++;
+
+    proc->leader = leader;
+    proc->phys_pdbr_addr = leader->phys_pdbr_addr;
+    proc->virt_pdbr_addr = leader->virt_pdbr_addr;
+    proc->address_space_refs = 0;
+    proc->thread_fn = fn;
+    proc->thread_arg = arg;
+
+    proc->id = pids++;
+    proc->user = false;
+    proc->priority = current_process->base_priority;
+    proc->base_priority = current_process->base_priority;
+    proc->time_slice = 0;
+    proc->wake_tick = 0;
+    proc->next = NULL;
+    proc->prev = NULL;
+    proc->on_cpu = false;
+
+    unlock_sheduler();
+
+    init_task_state(proc, READY);
+
+    lock_sheduler();
+
+    proc->cpu = select_cpu();
+    add_READY_process(proc);
+    kick_cpu(&cpus[proc->cpu], proc->priority);
+
+    unlock_sheduler();
+
+    return proc;
+}
+
+// the last user of an address space is gone: free it or keep it in the pool
+static void release_address_space(process_t* proc)
 {
-    // free address space
-    VIRTMEM_destroyAddressSpace(proc->virt_pdbr_addr);
+    // files left open by the program
+    for(int i = 0; i < PROCESS_MAX_FILES; i++)
+    {
+        if(proc->files[i] != VFS_EBADF)
+            VFS_close(proc->files[i]);
+    }
+
+    if(proc->exec_fd != VFS_EBADF)
+        VFS_close(proc->exec_fd);
+
+    // the user pages always go, the directory and the stack are kept if the pool has room
+    VIRTMEM_clearAddressSpace(proc->virt_pdbr_addr);
+
+    if(pool_put(proc))
+        return;
+
+    vfree(proc->virt_pdbr_addr);
 
     if(proc->stack)
         vfree(proc->stack);
@@ -246,43 +1195,73 @@ void delete_process(process_t* proc)
     kfree(proc);
 }
 
+void delete_process(process_t* proc)
+{
+    lock_sheduler();
+
+    if(proc->all_prev != NULL)
+        proc->all_prev->all_next = proc->all_next;
+    else
+        first_process = proc->all_next;
+
+    if(proc->all_next != NULL)
+        proc->all_next->all_prev = proc->all_prev;
+
+    unlock_sheduler();
+
+    process_t* owner = proc;
+
+    if(proc->leader != NULL)
+    {
+        // a thread only owns its stack
+        owner = proc->leader;
+        vfree(proc->stack);
+        kfree(proc);
+    }
+
+    lock_sheduler();
+    uint32_t refs = --owner->address_space_refs;
+    unlock_sheduler();
+
+    // a leader that exits before its threads stays allocated until the last one is cleaned
+    if(refs == 0)
+        release_address_space(owner);
+}
+
 void cleaner_task()
 {
+    finish_task_switch();
     unlock_sheduler();  // because it's the first time
 
     process_t* dead_task;
     while(true)
     {
-        if(first_DEAD_process != NULL)
-        {
-            lock_sheduler();
-            
-            dead_task = first_DEAD_process;
+        wait_event(&cleaner_queue, first_DEAD_process != NULL);
 
-            if(first_DEAD_process == last_DEAD_process)
-                last_DEAD_process = NULL;
-            
-            first_DEAD_process = first_DEAD_process->next;
-            
-            log_debug("cleaner", "cleaning 0x%x", dead_task);
+        lock_sheduler();
 
-            unlock_sheduler();
+        dead_task = first_DEAD_process;
 
-            delete_process(dead_task);
-            continue;
-        }
+        if(first_DEAD_process == last_DEAD_process)
+            last_DEAD_process = NULL;
 
-        block_current_task();
-        yield();
+        first_DEAD_process = first_DEAD_process->next;
+
+        log_debug("cleaner", "cleaning 0x%x", dead_task);
+
+        unlock_sheduler();
+
+        delete_process(dead_task);
     }
 }
 
-void initialize_multitasking()
+// the code running on a cpu when the scheduler starts there becomes its idle task
+static process_t* create_idle_task(int cpu)
 {
-    // create the first process which is the idle process
-    idle = kmalloc(sizeof(process_t));
+    process_t* idle = kmalloc(sizeof(process_t));
 
     idle->stack = NULL;     // no need to create a new stack because initially we already have one
+    idle->stack_size = 0;
 
     idle->esp = NULL;       // this will be filled automatically when a context switch occurs
 
@@ -290,18 +1269,44 @@ void initialize_multitasking()
     idle->virt_pdbr_addr = NULL;
     idle->id = pids++;
     idle->user = false;
+    idle->priority = PRIORITY_LOWEST;
+    idle->base_priority = PRIORITY_LOWEST;
+    idle->time_slice = 0;
+    idle->wake_tick = 0;
+    idle->leader = NULL;
+    idle->address_space_refs = 1;
+    idle->thread_fn = NULL;
+    idle->thread_arg = NULL;
     idle->next = NULL;
+    idle->prev = NULL;
+    idle->cpu = cpu;
+    idle->on_cpu = true;
+
+    cpus[cpu].idle = idle;
+    cpus[cpu].current = idle;
+    init_task_state(idle, RUNNING);
+
+    return idle;
+}
 
-    current_process = idle;
-    current_process->status = RUNNING;
+void initialize_multitasking()
+{
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+        cpus[i].id = i;
+
+    cpus[0].online = true;
+
+    // create the first process which is the idle process
+    create_idle_task(0);
 
     // create the cleaner process
     
     cleaner_process = kmalloc(sizeof(process_t));
 
-    cleaner_process->stack = vmalloc(1);
+    cleaner_process->stack = vmalloc(PROCESS_STACK_SIZE);
+    cleaner_process->stack_size = PROCESS_STACK_SIZE;
 
-    cleaner_process->esp = cleaner_process->stack + 0x1000 - 4;
+    cleaner_process->esp = cleaner_process->stack + cleaner_process->stack_size - 4;
     *(uint32_t*)cleaner_process->esp = (uint32_t)cleaner_task; // return address after context switch
 
     cleaner_process->esp -= (4 * 5);   // pushed register
@@ -311,103 +1316,181 @@ void initialize_multitasking()
     cleaner_process->virt_pdbr_addr = NULL;
     cleaner_process->id = pids++;
     cleaner_process->user = false;
-    cleaner_process->status = BLOCKED;
+    init_task_state(cleaner_process, READY);
+    cleaner_process->priority = PRIORITY_DEFAULT;
+    cleaner_process->base_priority = PRIORITY_DEFAULT;
+    cleaner_process->time_slice = 0;
+    cleaner_process->wake_tick = 0;
+    cleaner_process->leader = NULL;
+    cleaner_process->address_space_refs = 1;
+    cleaner_process->thread_fn = NULL;
+    cleaner_process->thread_arg = NULL;
     cleaner_process->next = NULL;
+    cleaner_process->prev = NULL;
+    cleaner_process->cpu = 0;
+    cleaner_process->on_cpu = false;
+
+    wait_queue_init(&cleaner_queue);
+    add_READY_process(cleaner_process);     // it runs once and goes to sleep on its wait queue
+
+    ISR_registerNewHandler(IPI_RESCHEDULE_VECTOR, reschedule_ipi);
+    ISR_registerNewHandler(IPI_TICK_VECTOR, tick_ipi);
+    ISR_registerNewHandler(FPU_TRAP_VECTOR, fpu_trap);
+
+    workqueue_init();
 }
 
-void terminate_task()
+// first code of the scheduler on an application processor, its boot stack becomes the idle task
+static void scheduler_ap_entry(int cpu)
 {
+    create_idle_task(cpu);
+
     lock_sheduler();
+    cpus[cpu].online = true;
+    unlock_sheduler();
+
+    log_info("multitask", "cpu %d is scheduling", cpu);
+
+    PIT_startCpuTick();
+    enableInterrupts();
+    idle_loop();
+}
+
+// once the boot cpu can schedule, give the others their own run queue
+void start_other_cpus()
+{
+    SMP_startCpus(scheduler_ap_entry);
+}
+
+// the stack is still in use until the switch: finish_task_switch hands it to the cleaner
+void terminate_task()
+{
+    process_t* proc = get_current_process();
 
-    add_DEAD_process(current_process);
+    // the asynchronous I/O worker stops with its process
+    if(proc->leader == NULL && proc->user)
+        ioring_exit(proc);
 
-    if(cleaner_process->status == BLOCKED)
-        unblock_task(cleaner_process);
+    lock_sheduler();
+
+    set_status(current_process, DEAD);
 
     unlock_sheduler();
     yield();
 }
 
-// sleeping list
-typedef struct sleep_process
+static void sleep_timeout(void* arg)
 {
-    process_t* proc;
-    uint64_t wake_time;
-	struct sleep_process *next;
-}__attribute__((packed)) sleep_process_t;
-
-sleep_process_t* sleep_list = NULL;
+    unblock_task((process_t*)arg);
+}
 
 void sleep(uint32_t ms)
 {
     lock_sheduler();
 
-    sleep_process_t* sleep_proc = kmalloc(sizeof(sleep_process_t));
-
-    sleep_proc->wake_time = getTickCount() + ms;
-    sleep_proc->proc = current_process;
-    sleep_proc->next = NULL;
+    // the timer node lives in the process, nothing to allocate
+    timer_init(&current_process->sleep_timer, sleep_timeout, current_process);
+    timer_add(&current_process->sleep_timer, ms);
 
     block_current_task();
-    
-    if(sleep_list == NULL)
-        sleep_list = sleep_proc;
-    else
-    {
-        sleep_process_t* current = sleep_list;
 
-        if(current->wake_time > sleep_proc->wake_time)
-        {
-            sleep_proc->next = sleep_list;
-            sleep_list = sleep_proc;
+    unlock_sheduler();
+    yield();
+}
 
-            goto End;
-        }
+static void register_mutex(mutex_t* mut)
+{
+    if(mut->registered)
+        return;
 
-        while (current->next != NULL)
-        {
-            if(current->next->wake_time > sleep_proc->wake_time)
-            {
-                sleep_proc->next = current->next;
-                current->next = sleep_proc;
+    mut->next_mutex = first_mutex;
+    first_mutex = mut;
+    mut->registered = true;
+}
 
-                goto End;
-            }
+static void unregister_mutex(mutex_t* mut)
+{
+    mutex_t** link = &first_mutex;
 
-            current = current->next;
-        }
+    while(*link != NULL && *link != mut)
+        link = &(*link)->next_mutex;
 
-        current->next = sleep_proc;
-    }
+    if(*link != NULL)
+        *link = mut->next_mutex;
 
-End:
-    unlock_sheduler();
-    yield();
+    mut->registered = false;
 }
 
-void wakeUp()
+// the scheduler is locked by the caller
+static void mutex_take(mutex_t* mut, process_t* proc)
 {
-    lock_sheduler();
+    mut->locked = true;
+    mut->locked_count = 0;
+    mut->owner = proc;
+    mut->acquisitions++;
+
+    mut->next_held = proc->held_mutexes;
+    proc->held_mutexes = mut;
+}
+
+static void mutex_drop(mutex_t* mut, process_t* proc)
+{
+    mutex_t** link = &proc->held_mutexes;
+
+    while(*link != NULL && *link != mut)
+        link = &(*link)->next_held;
 
-    if(sleep_list == NULL)
-        goto End;
+    if(*link != NULL)
+        *link = mut->next_held;
 
-    sleep_process_t* current;
+    mut->next_held = NULL;
+}
 
-    while(sleep_list != NULL && sleep_list->wake_time <= getTickCount())
+// raise the owner (and the owners it waits for) to the level of a waiter
+static void priority_inherit(process_t* owner, uint8_t priority)
+{
+    for(int depth = 0; owner != NULL && depth < MUTEX_PI_MAX_DEPTH; depth++)
     {
-        unblock_task(sleep_list->proc);
+        if(owner->priority <= priority)
+            break;
+
+        if(!owner->pi_boosted)
+        {
+            owner->pi_saved_priority = owner->priority;
+            owner->pi_boosted = true;
+        }
+
+        change_priority(owner, priority);
+        sched_stats.priority_inheritances++;
 
-        current = sleep_list;
-        sleep_list = sleep_list->next;
-        kfree(current);
+        owner = owner->blocked_on != NULL ? owner->blocked_on->owner : NULL;
     }
+}
 
-End:
-    unlock_sheduler();
+// highest level still needed by the waiters of the mutexes it holds
+static void priority_restore(process_t* proc)
+{
+    if(!proc->pi_boosted)
+        return;
+
+    uint8_t priority = proc->pi_saved_priority;
+
+    for(mutex_t* mut = proc->held_mutexes; mut != NULL; mut = mut->next_held)
+    {
+        for(process_t* waiter = mut->first_waiting_list; waiter != NULL; waiter = waiter->next)
+        {
+            if(waiter->priority < priority)
+                priority = waiter->priority;
+        }
+    }
+
+    if(priority == proc->pi_saved_priority)
+        proc->pi_boosted = false;
+
+    change_priority(proc, priority);
 }
 
-mutex_t* create_mutex()
+mutex_t* create_named_mutex(const char* name)
 {
     mutex_t* mut = kmalloc(sizeof(mutex_t));
 
@@ -416,81 +1499,177 @@ mutex_t* create_mutex()
     mut->owner = NULL;
     mut->first_waiting_list = NULL;
     mut->last_waiting_list = NULL;
+    mut->name = name;
+    mut->next_held = NULL;
+    mut->next_mutex = NULL;
+    mut->registered = false;
+    mut->acquisitions = 0;
+    mut->contended = 0;
+    mut->spin_acquisitions = 0;
+    mut->wait_ticks = 0;
 
     return mut;
 }
 
+mutex_t* create_mutex()
+{
+    return create_named_mutex("mutex");
+}
+
 void destroy_mutex(mutex_t* mut)
 {
+    lock_sheduler();
+    unregister_mutex(mut);
+    unlock_sheduler();
+
     kfree(mut);
 }
 
+/*
+ * Adaptive acquire: if the owner is runnable it will probably release the
+ * mutex soon, so give it the cpu a few times before blocking. A blocked
+ * waiter lends its priority to the owner and gets the mutex handed over
+ * directly by release_mutex (FIFO, no barging).
+ */
 void acquire_mutex(mutex_t* mut)
 {
-    if(mut->locked)
+    lock_sheduler();
+
+    register_mutex(mut);
+
+    if(!mut->locked)
     {
-        if(mut->owner == current_process)
-        {
-            mut->locked_count++;    // it's okay we can acquire a mutex multiple time
-            return; 
-        }
-        
-        lock_sheduler();
-        current_process->next = NULL;
+        mutex_take(mut, current_process);
+        unlock_sheduler();
+        return;
+    }
 
-        if(!mut->first_waiting_list)
-            mut->first_waiting_list = current_process;
-    
-        if(mut->last_waiting_list)
-            mut->last_waiting_list->next = current_process;
+    if(mut->owner == current_process)
+    {
+        mut->locked_count++;    // it's okay we can acquire a mutex multiple time
+        unlock_sheduler();
+        return;
+    }
 
-        mut->last_waiting_list = current_process;
-        mut->last_waiting_list->next = NULL;
+    uint64_t start = getTickCount();
+    mut->contended++;
 
-        block_current_task();
+    // spinning is useless if the owner is blocked, it can't release the mutex before it wakes up
+    for(int i = 0; i < MUTEX_SPIN_YIELDS && mut->locked && (mut->owner->status == READY || mut->owner->status == RUNNING); i++)
+    {
         unlock_sheduler();
         yield();
+        lock_sheduler();
     }
-    else
+
+    if(!mut->locked)
     {
-        mut->locked = true;
-        mut->owner = current_process;
+        mutex_take(mut, current_process);
+        mut->spin_acquisitions++;
+        mut->wait_ticks += getTickCount() - start;
+        unlock_sheduler();
+        return;
     }
+
+    current_process->next = NULL;
+
+    if(!mut->first_waiting_list)
+        mut->first_waiting_list = current_process;
+
+    if(mut->last_waiting_list)
+        mut->last_waiting_list->next = current_process;
+
+    mut->last_waiting_list = current_process;
+    current_process->blocked_on = mut;
+
+    priority_inherit(mut->owner, current_process->priority);
+
+    block_current_task();
+    unlock_sheduler();
+    yield();
+
+    // release_mutex made us the owner before waking us up
+    lock_sheduler();
+    mut->wait_ticks += getTickCount() - start;
+    unlock_sheduler();
 }
 
 void release_mutex(mutex_t* mut)
 {
+    lock_sheduler();
+
     if(mut->owner != current_process)
     {
-        log_err("mutex", "Process %d tried to release mutex it doesn't own!", current_process->id);
+        int id = current_process->id;
+
+        unlock_sheduler();
+        log_err("mutex", "Process %d tried to release mutex it doesn't own!", id);
         return;
     }
 
     if(mut->locked_count != 0)
     {
         mut->locked_count--;
+        unlock_sheduler();
         return;
     }
 
+    mutex_drop(mut, current_process);
+
     if(mut->first_waiting_list != NULL)
     {
-        lock_sheduler();
-
         process_t* released = mut->first_waiting_list;
 
         if(mut->first_waiting_list == mut->last_waiting_list)
-            mut->last_waiting_list = mut->last_waiting_list->next; // null
-        
-        mut->first_waiting_list = mut->first_waiting_list->next;
+            mut->last_waiting_list = NULL;
+
+        mut->first_waiting_list = released->next;
+        released->next = NULL;
+        released->blocked_on = NULL;
 
-        mut->owner = released;  // new owner
+        mutex_take(mut, released);  // hand it over, nobody can steal it before the waiter runs
+
+        // the remaining waiters now wait for the new owner
+        for(process_t* waiter = mut->first_waiting_list; waiter != NULL; waiter = waiter->next)
+            priority_inherit(released, waiter->priority);
 
         unblock_task(released);
-        unlock_sheduler();
     }
     else
     {
         mut->locked = false;
         mut->owner = NULL;
     }
-}
\ No newline at end of file
+
+    priority_restore(current_process);
+
+    unlock_sheduler();
+}
+
+// copy the statistics of up to max_count mutexes, returns how many were copied
+int get_mutex_stats(mutex_stats_t* stats, int max_count)
+{
+    int count = 0;
+
+    lock_sheduler();
+
+    for(mutex_t* mut = first_mutex; mut != NULL && count < max_count; mut = mut->next_mutex)
+    {
+        stats[count].name = mut->name != NULL ? mut->name : "?";
+        stats[count].locked = mut->locked;
+        stats[count].owner = mut->owner != NULL ? mut->owner->id : -1;
+        stats[count].waiters = 0;
+        stats[count].acquisitions = mut->acquisitions;
+        stats[count].contended = mut->contended;
+        stats[count].spin_acquisitions = mut->spin_acquisitions;
+        stats[count].wait_ticks = mut->wait_ticks;
+
+        for(process_t* waiter = mut->first_waiting_list; waiter != NULL; waiter = waiter->next)
+            stats[count].waiters++;
+
+        count++;
+    }
+
+    unlock_sheduler();
+    return count;
+}
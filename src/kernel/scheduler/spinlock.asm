@@ -0,0 +1,55 @@
+; Copyright (C) 2025,  Novice
+;
+; This file is part of the Novix software.
+;
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+;
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+;
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+[bits 32]
+
+; test and test-and-set: xchg is always locked, the waiting loop only
+; reads so the cache line isn't bounced between the waiting cpus
+
+global spin_lock
+spin_lock:
+    mov edx, [esp+4]    ; lock
+
+.retry:
+    mov eax, 1
+    xchg eax, [edx]
+    test eax, eax
+    jnz .wait
+    ret
+
+.wait:
+    pause
+    cmp dword [edx], 0
+    jne .wait
+    jmp .retry
+
+; returns 1 if the lock was taken
+global spin_trylock
+spin_trylock:
+    mov edx, [esp+4]
+    mov eax, 1
+    xchg eax, [edx]
+    xor eax, 1
+    ret
+
+; a plain store is a release on x86
+global spin_unlock
+spin_unlock:
+    mov edx, [esp+4]
+    mov dword [edx], 0
+    ret
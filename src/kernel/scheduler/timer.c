@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include <hal/pit.h>
+#include <scheduler/multitask.h>
+#include <scheduler/timer.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+/*
+ * Hierarchical timing wheel (one tick = 1ms).
+ * tv1 has one slot per tick for the next 256 ticks, every outer wheel
+ * slot covers a whole turn of the wheel below it. When tv1 wraps, the
+ * next slot of tv2 is cascaded down (and so on), so insertion is O(1)
+ * and every timer is moved at most 4 times before it expires.
+ */
+
+#define TVR_BITS    8
+#define TVN_BITS    6
+#define TVR_SIZE    (1 << TVR_BITS)     // 256
+#define TVN_SIZE    (1 << TVN_BITS)     // 64
+#define TVR_MASK    (TVR_SIZE - 1)
+#define TVN_MASK    (TVN_SIZE - 1)
+
+#define MAX_TIMEOUT 0xFFFFFFFFULL       // ~49 days
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+ktimer_t* tv1[TVR_SIZE];
+ktimer_t* tv2[TVN_SIZE];
+ktimer_t* tv3[TVN_SIZE];
+ktimer_t* tv4[TVN_SIZE];
+ktimer_t* tv5[TVN_SIZE];
+
+uint64_t timer_jiffies = 0;   // next tick to be processed by the wheel
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+static void link_timer(ktimer_t* timer, ktimer_t** slot)
+{
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = *slot;
+
+    if(*slot != NULL)
+        (*slot)->prev = timer;
+
+    *slot = timer;
+}
+
+static void unlink_timer(ktimer_t* timer)
+{
+    if(timer->prev != NULL)
+        timer->prev->next = timer->next;
+    else
+        *timer->slot = timer->next;
+
+    if(timer->next != NULL)
+        timer->next->prev = timer->prev;
+
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->slot = NULL;
+}
+
+static void internal_add_timer(ktimer_t* timer)
+{
+    uint64_t expires = timer->expires;
+    int64_t idx = (int64_t)(expires - timer_jiffies);
+    ktimer_t** slot;
+
+    if(idx < 0)
+    {
+        // already expired, run it on the next tick
+        slot = &tv1[timer_jiffies & TVR_MASK];
+    }
+    else if(idx < TVR_SIZE)
+        slot = &tv1[expires & TVR_MASK];
+    else if(idx < (1 << (TVR_BITS + TVN_BITS)))
+        slot = &tv2[(expires >> TVR_BITS) & TVN_MASK];
+    else if(idx < (1 << (TVR_BITS + 2 * TVN_BITS)))
+        slot = &tv3[(expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK];
+    else if(idx < (1 << (TVR_BITS + 3 * TVN_BITS)))
+        slot = &tv4[(expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK];
+    else
+    {
+        if(idx > MAX_TIMEOUT)
+        {
+            idx = MAX_TIMEOUT;
+            timer->expires = expires = timer_jiffies + idx;
+        }
+
+        slot = &tv5[(expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK];
+    }
+
+    link_timer(timer, slot);
+}
+
+// move every timer of an outer slot to the wheels below
+static uint32_t cascade(ktimer_t** tv, uint32_t index)
+{
+    ktimer_t* timer = tv[index];
+    ktimer_t* next;
+
+    tv[index] = NULL;
+
+    while(timer != NULL)
+    {
+        next = timer->next;
+        internal_add_timer(timer);
+        timer = next;
+    }
+
+    return index;
+}
+
+#define TV_INDEX(n) ((timer_jiffies >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+void timer_init(ktimer_t* timer, timer_callback_t callback, void* arg)
+{
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->slot = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->pending = false;
+}
+
+// (re)arm a timer to fire in 'ms' ticks
+void timer_add(ktimer_t* timer, uint32_t ms)
+{
+    lock_sheduler();
+
+    if(timer->pending)
+        unlink_timer(timer);
+
+    timer->expires = getTickCount() + ms;
+    timer->pending = true;
+    internal_add_timer(timer);
+
+    unlock_sheduler();
+}
+
+// returns true if the timer was still pending
+bool timer_cancel(ktimer_t* timer)
+{
+    bool was_pending;
+
+    lock_sheduler();
+
+    was_pending = timer->pending;
+    if(was_pending)
+    {
+        unlink_timer(timer);
+        timer->pending = false;
+    }
+
+    unlock_sheduler();
+    return was_pending;
+}
+
+/*
+ * Number of ticks until the first pending timer, at most 'max_ticks'.
+ * Only tv1 is scanned: reaching the end of tv1 means a cascade is due, so
+ * we stop there and let the outer wheels refill it.
+ */
+uint32_t timer_next_event(uint32_t max_ticks)
+{
+    uint32_t ticks = 0;
+
+    lock_sheduler();
+
+    // the slot of timer_jiffies is due on the next tick
+    for(uint64_t jiffy = timer_jiffies; ticks < max_ticks; jiffy++)
+    {
+        uint32_t index = jiffy & TVR_MASK;
+
+        ticks++;
+        if(tv1[index] != NULL || index == 0)
+            break;
+    }
+
+    // timer_jiffies lags one tick behind the tick count
+    if(timer_jiffies <= getTickCount())
+        ticks = 0;
+
+    unlock_sheduler();
+    return ticks;
+}
+
+// called from the timer irq, runs every timer that expired since the last call
+void timer_tick()
+{
+    ktimer_t* timer;
+    ktimer_t* expired;
+
+    lock_sheduler();
+
+    while(timer_jiffies <= getTickCount())
+    {
+        uint32_t index = timer_jiffies & TVR_MASK;
+
+        // tv1 wrapped, pull the next round of timers from the outer wheels
+        if(index == 0 &&
+           cascade(tv2, TV_INDEX(0)) == 0 &&
+           cascade(tv3, TV_INDEX(1)) == 0 &&
+           cascade(tv4, TV_INDEX(2)) == 0)
+            cascade(tv5, TV_INDEX(3));
+
+        expired = tv1[index];
+        tv1[index] = NULL;
+        timer_jiffies++;
+
+        // a callback may cancel or re-arm a timer further down, so they stay linked on a
+        // local list and are popped one at a time
+        for(timer = expired; timer != NULL; timer = timer->next)
+            timer->slot = &expired;
+
+        while(expired != NULL)
+        {
+            timer = expired;
+            unlink_timer(timer);
+            timer->pending = false;
+
+            timer->callback(timer->arg);
+        }
+    }
+
+    unlock_sheduler();
+}
@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <scheduler/multitask.h>
+#include <scheduler/timer.h>
+#include <scheduler/waitqueue.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+static void wait_queue_remove(wait_queue_t* wq, process_t* proc)
+{
+    if(proc->prev != NULL)
+        proc->prev->next = proc->next;
+    else
+        wq->first = proc->next;
+
+    if(proc->next != NULL)
+        proc->next->prev = proc->prev;
+    else
+        wq->last = proc->prev;
+
+    proc->next = NULL;
+    proc->prev = NULL;
+    proc->waiting_on = NULL;
+}
+
+// the task is off the queue and its time out timer is stopped, make it runnable
+static void wake_up_task(wait_queue_t* wq, process_t* proc)
+{
+    wait_queue_remove(wq, proc);
+    timer_cancel(&proc->sleep_timer);
+    unblock_task(proc);
+}
+
+// runs in the timer irq
+static void wait_timeout(void* arg)
+{
+    process_t* proc = (process_t*)arg;
+
+    lock_sheduler();
+
+    if(proc->waiting_on != NULL)    // nobody woke it up first
+    {
+        wait_queue_remove(proc->waiting_on, proc);
+        unblock_task(proc);
+    }
+
+    unlock_sheduler();
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+void wait_queue_init(wait_queue_t* wq)
+{
+    wq->first = NULL;
+    wq->last = NULL;
+}
+
+// queue the current task and mark it blocked, the scheduler must be locked (see wait_event)
+void wait_queue_block(wait_queue_t* wq)
+{
+    process_t* proc = get_current_process();
+
+    // still queued from the last round (no other task was ready to run)
+    if(proc->waiting_on != wq)
+    {
+        proc->next = NULL;
+        proc->prev = wq->last;
+
+        if(wq->last != NULL)
+            wq->last->next = proc;
+        else
+            wq->first = proc;
+
+        wq->last = proc;
+        proc->waiting_on = wq;
+    }
+
+    block_current_task();
+}
+
+void wait_queue_block_timeout(wait_queue_t* wq, uint32_t ms)
+{
+    process_t* proc = get_current_process();
+
+    wait_queue_block(wq);
+
+    timer_init(&proc->sleep_timer, wait_timeout, proc);
+    timer_add(&proc->sleep_timer, ms);
+}
+
+// leave the queue after the wait, only needed when the task didn't really sleep
+void wait_queue_finish(wait_queue_t* wq)
+{
+    process_t* proc = get_current_process();
+
+    if(proc->waiting_on == wq)
+        wait_queue_remove(wq, proc);
+
+    timer_cancel(&proc->sleep_timer);
+}
+
+bool wait_queue_empty(wait_queue_t* wq)
+{
+    return wq->first == NULL;
+}
+
+uint32_t wake_up_one(wait_queue_t* wq)
+{
+    uint32_t woken = 0;
+
+    lock_sheduler();
+
+    if(wq->first != NULL)
+    {
+        wake_up_task(wq, wq->first);
+        woken++;
+    }
+
+    unlock_sheduler();
+    return woken;
+}
+
+uint32_t wake_up_all(wait_queue_t* wq)
+{
+    uint32_t woken = 0;
+
+    lock_sheduler();
+
+    while(wq->first != NULL)
+    {
+        wake_up_task(wq, wq->first);
+        woken++;
+    }
+
+    unlock_sheduler();
+    return woken;
+}
+
+// wake up a given task of the queue (picked by the caller), the scheduler must be locked
+void wake_up_task_locked(wait_queue_t* wq, process_t* proc)
+{
+    if(proc->waiting_on == wq)
+        wake_up_task(wq, proc);
+}
+
+void semaphore_init(semaphore_t* sem, int32_t count)
+{
+    sem->count = count;
+    wait_queue_init(&sem->waiters);
+}
+
+void semaphore_down(semaphore_t* sem)
+{
+    lock_sheduler();
+
+    while(sem->count <= 0)
+    {
+        wait_queue_block(&sem->waiters);
+        unlock_sheduler();
+        yield();
+        lock_sheduler();
+    }
+
+    sem->count--;
+    wait_queue_finish(&sem->waiters);
+
+    unlock_sheduler();
+}
+
+// returns false if the semaphore couldn't be taken within 'ms'
+bool semaphore_down_timeout(semaphore_t* sem, uint32_t ms)
+{
+    bool taken = false;
+    uint64_t deadline = getTickCount() + ms;
+    uint64_t now;
+
+    lock_sheduler();
+
+    while(sem->count <= 0)
+    {
+        now = getTickCount();
+        if(now >= deadline)
+            break;
+
+        wait_queue_block_timeout(&sem->waiters, deadline - now);
+        unlock_sheduler();
+        yield();
+        lock_sheduler();
+    }
+
+    if(sem->count > 0)
+    {
+        sem->count--;
+        taken = true;
+    }
+
+    wait_queue_finish(&sem->waiters);
+
+    unlock_sheduler();
+    return taken;
+}
+
+bool semaphore_trydown(semaphore_t* sem)
+{
+    bool taken = false;
+
+    lock_sheduler();
+
+    if(sem->count > 0)
+    {
+        sem->count--;
+        taken = true;
+    }
+
+    unlock_sheduler();
+    return taken;
+}
+
+// can be called from an irq handler
+void semaphore_up(semaphore_t* sem)
+{
+    lock_sheduler();
+
+    sem->count++;
+    wake_up_one(&sem->waiters);
+
+    unlock_sheduler();
+}
+
+void condvar_init(condvar_t* cv)
+{
+    wait_queue_init(&cv->waiters);
+}
+
+// 'mut' must be held once by the caller, it is released while waiting and taken back before returning
+void condvar_wait(condvar_t* cv, mutex_t* mut)
+{
+    lock_sheduler();
+
+    wait_queue_block(&cv->waiters);
+    release_mutex(mut);
+
+    unlock_sheduler();
+    yield();
+
+    lock_sheduler();
+    wait_queue_finish(&cv->waiters);
+    unlock_sheduler();
+
+    acquire_mutex(mut);
+}
+
+void condvar_signal(condvar_t* cv)
+{
+    wake_up_one(&cv->waiters);
+}
+
+void condvar_broadcast(condvar_t* cv)
+{
+    wake_up_all(&cv->waiters);
+}
+
+void rwlock_init(rwlock_t* lock)
+{
+    lock->readers = 0;
+    lock->writer = false;
+    lock->writers_waiting = 0;
+    wait_queue_init(&lock->read_queue);
+    wait_queue_init(&lock->write_queue);
+}
+
+void read_lock(rwlock_t* lock)
+{
+    lock_sheduler();
+
+    // writer preference: don't pass a waiting writer
+    while(lock->writer || lock->writers_waiting > 0)
+    {
+        wait_queue_block(&lock->read_queue);
+        unlock_sheduler();
+        yield();
+        lock_sheduler();
+    }
+
+    lock->readers++;
+    wait_queue_finish(&lock->read_queue);
+
+    unlock_sheduler();
+}
+
+void read_unlock(rwlock_t* lock)
+{
+    lock_sheduler();
+
+    lock->readers--;
+
+    if(lock->readers == 0)
+        wake_up_one(&lock->write_queue);
+
+    unlock_sheduler();
+}
+
+void write_lock(rwlock_t* lock)
+{
+    lock_sheduler();
+
+    lock->writers_waiting++;
+
+    while(lock->writer || lock->readers > 0)
+    {
+        wait_queue_block(&lock->write_queue);
+        unlock_sheduler();
+        yield();
+        lock_sheduler();
+    }
+
+    lock->writers_waiting--;
+    lock->writer = true;
+    wait_queue_finish(&lock->write_queue);
+
+    unlock_sheduler();
+}
+
+void write_unlock(rwlock_t* lock)
+{
+    lock_sheduler();
+
+    lock->writer = false;
+
+    // the next writer first, the readers get the lock when no writer is left
+    if(lock->writers_waiting > 0)
+        wake_up_one(&lock->write_queue);
+    else
+        wake_up_all(&lock->read_queue);
+
+    unlock_sheduler();
+}
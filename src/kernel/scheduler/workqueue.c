@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <debug.h>
+#include <hal/pit.h>
+#include <scheduler/multitask.h>
+#include <scheduler/waitqueue.h>
+#include <scheduler/workqueue.h>
+
+/*
+ * Deferred work (bottom halves). Irq handlers queue small items and a
+ * kernel thread at the highest priority runs them with interrupts
+ * enabled, as soon as the irq returns.
+ */
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+#define WORKER_STACK_SIZE   0x2000
+
+typedef struct work
+{
+    work_func_t func;
+    void* arg;
+    uint64_t queued_tick;
+}work_t;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+work_t work_ring[WORKQUEUE_SIZE];
+uint32_t work_head = 0;    // next free slot
+uint32_t work_count = 0;
+
+wait_queue_t work_wait;
+process_t* worker;
+work_stats_t work_stats;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE FUNCTIONS
+//============================================================================
+
+static void worker_thread(void* arg)
+{
+    work_t work;
+
+    while(true)
+    {
+        wait_event(&work_wait, work_count > 0);
+
+        lock_sheduler();
+
+        work = work_ring[(work_head - work_count) % WORKQUEUE_SIZE];
+        work_count--;
+        work_stats.latency_ticks += getTickCount() - work.queued_tick;
+
+        unlock_sheduler();
+
+        work.func(work.arg);   // interrupts are enabled here
+
+        work_stats.executed++;
+    }
+}
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+void workqueue_init()
+{
+    wait_queue_init(&work_wait);
+
+    worker = create_thread(worker_thread, NULL, WORKER_STACK_SIZE);
+    if(worker == NULL)
+    {
+        log_err("workqueue", "failed to create the worker thread");
+        return;
+    }
+
+    setpriority(worker, PRIORITY_HIGHEST);
+}
+
+// safe from irq handlers, returns false if the queue is full
+bool schedule_work(work_func_t func, void* arg)
+{
+    lock_sheduler();
+
+    if(work_count >= WORKQUEUE_SIZE)
+    {
+        work_stats.dropped++;
+        unlock_sheduler();
+        return false;
+    }
+
+    work_ring[work_head].func = func;
+    work_ring[work_head].arg = arg;
+    work_ring[work_head].queued_tick = getTickCount();
+    work_head = (work_head + 1) % WORKQUEUE_SIZE;
+    work_count++;
+
+    work_stats.queued++;
+    if(work_count > work_stats.max_pending)
+        work_stats.max_pending = work_count;
+
+    wake_up_one(&work_wait);
+
+    unlock_sheduler();
+    return true;
+}
+
+void get_workqueue_stats(work_stats_t* stats)
+{
+    lock_sheduler();
+    *stats = work_stats;
+    unlock_sheduler();
+}
@@ -24,15 +24,21 @@
 #include <stdbool.h>
 #include <hal/io.h>
 #include <hal/pit.h>
+#include <hal/irq.h>
+#include <hal/syscall.h>
+#include <hal/clock.h>
 #include <memmgr/physmem_manager.h>
 #include <memmgr/virtmem_manager.h>
 #include <memmgr/heap.h>
 #include <scheduler/usermode.h>
+#include <scheduler/multitask.h>
+#include <scheduler/workqueue.h>
 #include <vfs/vfs.h>
 #include <drivers/fdc.h>
 #include <memory.h>
 #include <string.h>
 #include <shell.h>
+#include <trace.h>
 
 //============================================================================
 //    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
@@ -40,6 +46,8 @@
 
 #define MAX_CHAR_PROMPT 256
 #define MAX_CMD_ARGS    64
+#define MAX_PS_PROCESS  32
+#define MAX_MUTEX_STATS 16
 
 typedef enum {
     QUOTE_STATE_FREE,
@@ -55,6 +63,8 @@ char prompt[MAX_CHAR_PROMPT];
 char* args[MAX_CMD_ARGS];
 int argc;
 
+const char* const g_StatusNames[] = {"dead", "run", "ready", "block"};
+
 //============================================================================
 //    IMPLEMENTATION PRIVATE FUNCTIONS
 //============================================================================
@@ -247,6 +257,19 @@ void dumpsectorCommand(int argc, char** argv);
 void physmeminfoCommand(int argc, char** argv);
 void readfileCommand(int argc, char** argv);
 void usermodecommand(int argc, char** argv);
+void schedstatCommand(int argc, char** argv);
+void ticklessCommand(int argc, char** argv);
+void psCommand(int argc, char** argv);
+void schedumpCommand(int argc, char** argv);
+void mutexstatCommand(int argc, char** argv);
+void irqstatCommand(int argc, char** argv);
+void cpusCommand(int argc, char** argv);
+void sysbenchCommand(int argc, char** argv);
+void syscallstatCommand(int argc, char** argv);
+void aioCommand(int argc, char** argv);
+void elfCommand(int argc, char** argv);
+void clockCommand(int argc, char** argv);
+void traceCommand(int argc, char** argv);
 void shellExecute()
 {
     
@@ -264,6 +287,32 @@ void shellExecute()
         physmeminfoCommand(argc, args);
     else if(strcmp(prompt, "readfile") == 0)
         readfileCommand(argc, args);
+    else if(strcmp(prompt, "schedstat") == 0)
+        schedstatCommand(argc, args);
+    else if(strcmp(prompt, "tickless") == 0)
+        ticklessCommand(argc, args);
+    else if(strcmp(prompt, "ps") == 0)
+        psCommand(argc, args);
+    else if(strcmp(prompt, "schedump") == 0)
+        schedumpCommand(argc, args);
+    else if(strcmp(prompt, "mutexstat") == 0)
+        mutexstatCommand(argc, args);
+    else if(strcmp(prompt, "irqstat") == 0)
+        irqstatCommand(argc, args);
+    else if(strcmp(prompt, "cpus") == 0)
+        cpusCommand(argc, args);
+    else if(strcmp(prompt, "sysbench") == 0)
+        sysbenchCommand(argc, args);
+    else if(strcmp(prompt, "syscallstat") == 0)
+        syscallstatCommand(argc, args);
+    else if(strcmp(prompt, "aio") == 0)
+        aioCommand(argc, args);
+    else if(strcmp(prompt, "elf") == 0)
+        elfCommand(argc, args);
+    else if(strcmp(prompt, "clock") == 0)
+        clockCommand(argc, args);
+    else if(strcmp(prompt, "trace") == 0)
+        traceCommand(argc, args);
     else
         printf("%s: Unknown command", prompt);
 
@@ -306,6 +355,58 @@ void helpCommand(int argc, char** argv)
     VGA_coloredPuts(" - usermode", VGA_COLOR_LIGHT_CYAN);
     VGA_moveCursorTo(VGA_getCurrentLine(), 25);
     puts(": jump and run a usermode program !\n");
+
+    VGA_coloredPuts(" - schedstat", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": scheduler (MLFQ) statistics\n");
+
+    VGA_coloredPuts(" - tickless", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": stop the periodic tick when idle (on/off)\n");
+
+    VGA_coloredPuts(" - ps", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": list the processes and their cpu usage\n");
+
+    VGA_coloredPuts(" - schedump", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": dump scheduler statistics to the debug port\n");
+
+    VGA_coloredPuts(" - mutexstat", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": mutex contention statistics\n");
+
+    VGA_coloredPuts(" - irqstat", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": irq handler times and deferred work\n");
+
+    VGA_coloredPuts(" - cpus", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": per cpu run queues\n");
+
+    VGA_coloredPuts(" - sysbench", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": null syscall cost, int 0x80 against sysenter\n");
+
+    VGA_coloredPuts(" - syscallstat", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": calls per system call\n");
+
+    VGA_coloredPuts(" - aio", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": asynchronous file read through the I/O rings\n");
+
+    VGA_coloredPuts(" - elf", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": run an ELF program (demand paged), /bigbss.elf by default\n");
+
+    VGA_coloredPuts(" - clock", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": clocksource, switch it with tsc/pit\n");
+
+    VGA_coloredPuts(" - trace", VGA_COLOR_LIGHT_CYAN);
+    VGA_moveCursorTo(VGA_getCurrentLine(), 25);
+    puts(": event tracing, on/off/clear/dump (to debugcon)\n");
 }
 
 void physmeminfoCommand(int argc, char** argv)
@@ -320,6 +421,107 @@ void physmeminfoCommand(int argc, char** argv)
     printf("total used block: %d\n", info.totalUsedBlock);
 }
 
+void schedstatCommand(int argc, char** argv)
+{
+    sched_stats_t stats;
+
+    get_scheduler_stats(&stats);
+
+    printf("uptime (ticks): %d\n", (uint32_t)getTickCount());
+    printf("context switches: %d\n", (uint32_t)stats.context_switches);
+    printf("preemptions: %d\n", (uint32_t)stats.preemptions);
+    printf("demotions: %d\n", (uint32_t)stats.demotions);
+    printf("promotions: %d\n", (uint32_t)stats.promotions);
+    printf("priority boosts: %d\n", (uint32_t)stats.boosts);
+    printf("wake ups: %d\n", (uint32_t)stats.wakeups);
+
+    if(stats.wakeups != 0)
+        printf("average wake up latency (ticks): %d\n", (uint32_t)(stats.wake_latency_ticks / stats.wakeups));
+
+    printf("timer interrupts: %d\n", (uint32_t)PIT_getInterruptCount());
+    printf("idle wake ups: %d\n", (uint32_t)stats.idle_wakeups);
+    printf("tickless idle entries: %d\n", (uint32_t)stats.tickless_entries);
+    printf("process pool hits/misses: %d/%d\n", (uint32_t)stats.pool_hits, (uint32_t)stats.pool_misses);
+    printf("priority inheritances: %d\n", (uint32_t)stats.priority_inheritances);
+    printf("tasks stolen by idle cpus: %d\n", (uint32_t)stats.steals);
+    printf("lazy FPU state loads: %d\n", (uint32_t)stats.fpu_loads);
+
+    puts("wake up latency histogram (ticks: count):");
+    for(int i = 0; i < SCHED_LATENCY_BUCKETS; i++)
+    {
+        if(stats.wake_latency_hist[i] != 0)
+            printf(" <%d: %d", 1 << i, stats.wake_latency_hist[i]);
+    }
+    putc('\n');
+}
+
+void psCommand(int argc, char** argv)
+{
+    process_info_t info[MAX_PS_PROCESS];
+    int count = get_process_info(info, MAX_PS_PROCESS);
+
+    puts("  pid  state  prio  cpu      ready    blocked  vol    invol\n");
+
+    for(int i = 0; i < count; i++)
+    {
+        printf("  %d", info[i].id);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 7);
+        printf("%s", g_StatusNames[info[i].status]);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 14);
+        printf("%d/%d", info[i].priority, info[i].base_priority);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 20);
+        printf("%d", (uint32_t)info[i].cpu_ticks);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 29);
+        printf("%d", (uint32_t)info[i].ready_ticks);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 38);
+        printf("%d", (uint32_t)info[i].blocked_ticks);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 47);
+        printf("%d", info[i].voluntary_switches);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 54);
+        printf("%d%s\n", info[i].involuntary_switches, info[i].user ? "  (user)" : "");
+    }
+}
+
+// one "key=value" record per line so it can be parsed from the debugcon log
+void schedumpCommand(int argc, char** argv)
+{
+    sched_stats_t stats;
+    process_info_t info[MAX_PS_PROCESS];
+    int count;
+
+    get_scheduler_stats(&stats);
+    count = get_process_info(info, MAX_PS_PROCESS);
+
+    debugf("sched tick=%llu switches=%llu preemptions=%llu demotions=%llu promotions=%llu boosts=%llu wakeups=%llu wake_latency=%llu timer_irqs=%llu idle_wakeups=%llu tickless=%llu pool_hits=%llu pool_misses=%llu\n",
+           getTickCount(), stats.context_switches, stats.preemptions, stats.demotions, stats.promotions, stats.boosts,
+           stats.wakeups, stats.wake_latency_ticks, PIT_getInterruptCount(), stats.idle_wakeups, stats.tickless_entries,
+           stats.pool_hits, stats.pool_misses);
+
+    for(int i = 0; i < SCHED_LATENCY_BUCKETS; i++)
+        debugf("latency bucket=%d below=%u count=%u\n", i, 1u << i, stats.wake_latency_hist[i]);
+
+    for(int i = 0; i < count; i++)
+    {
+        debugf("task pid=%d state=%s user=%d prio=%d base=%d cpu=%llu ready=%llu blocked=%llu vol=%u invol=%u\n",
+               info[i].id, g_StatusNames[info[i].status], info[i].user, info[i].priority, info[i].base_priority,
+               info[i].cpu_ticks, info[i].ready_ticks, info[i].blocked_ticks,
+               info[i].voluntary_switches, info[i].involuntary_switches);
+    }
+
+    puts("scheduler statistics written to the debug port\n");
+}
+
+void ticklessCommand(int argc, char** argv)
+{
+    if(argc != 2 || (strcmp(argv[1], "on") != 0 && strcmp(argv[1], "off") != 0))
+    {
+        puts("Usage: tickless <on|off>");
+        return;
+    }
+
+    set_tickless_idle(strcmp(argv[1], "on") == 0);
+}
+
 void usermodecommand(int argc, char** argv)
 {
     int fd1 = VFS_open("/userprog.bin", VFS_O_RDWR);
@@ -394,4 +596,196 @@ void dumpsectorCommand(int argc, char** argv)
         waitForKeyPress();
     }
 
-}
\ No newline at end of file
+}
+
+void mutexstatCommand(int argc, char** argv)
+{
+    mutex_stats_t stats[MAX_MUTEX_STATS];
+    int count = get_mutex_stats(stats, MAX_MUTEX_STATS);
+
+    puts("  name         owner  wait  acquired   contended  spun     wait ticks\n");
+
+    for(int i = 0; i < count; i++)
+    {
+        printf("  %s", stats[i].name);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 15);
+        if(stats[i].owner >= 0)
+            printf("%d", stats[i].owner);
+        else
+            putc('-');
+        VGA_moveCursorTo(VGA_getCurrentLine(), 22);
+        printf("%d", stats[i].waiters);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 28);
+        printf("%d", (uint32_t)stats[i].acquisitions);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 39);
+        printf("%d", (uint32_t)stats[i].contended);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 50);
+        printf("%d", (uint32_t)stats[i].spin_acquisitions);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 59);
+        printf("%d\n", (uint32_t)stats[i].wait_ticks);
+    }
+}
+
+void irqstatCommand(int argc, char** argv)
+{
+    irq_stats_t stats;
+    work_stats_t work;
+
+    // without a time stamp counter the irqs are timed in ns, at tick granularity
+    puts(CLOCK_getTscKhz() != 0 ? "  irq  count      avg cycles  max cycles  avg eoi\n"
+                                : "  irq  count      avg ns      max ns      avg eoi\n");
+
+    for(int irq = 0; irq < 16; irq++)
+    {
+        IRQ_getStats(irq, &stats);
+        if(stats.count == 0)
+            continue;
+
+        printf("  %d", irq);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 7);
+        printf("%llu", stats.count);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 18);
+        printf("%llu", stats.total_cycles / stats.count);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 30);
+        printf("%llu", stats.max_cycles);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 42);
+        printf("%llu\n", stats.eoi_cycles / stats.count);
+    }
+
+    printf("interrupt controller: %s\n", IRQ_isApicEnabled() ? "io apic + local apic" : "8259 PIC");
+    printf("tick source: %s, %d counts per tick\n", PIT_usesLapicTimer() ? "local apic timer" : "PIT", PIT_getCountPerTick());
+
+    get_workqueue_stats(&work);
+
+    printf("work queued/executed/dropped: %d/%d/%d\n", (uint32_t)work.queued, (uint32_t)work.executed, (uint32_t)work.dropped);
+    printf("work max pending: %d\n", work.max_pending);
+
+    if(work.executed != 0)
+        printf("average work latency (ticks): %d\n", (uint32_t)(work.latency_ticks / work.executed));
+}
+
+void cpusCommand(int argc, char** argv)
+{
+    cpu_info_t info[SMP_MAX_CPUS];
+    int count = get_cpu_info(info, SMP_MAX_CPUS);
+
+    puts("  cpu  current  ready  switches   steals  idle wake ups\n");
+
+    for(int i = 0; i < count; i++)
+    {
+        printf("  %d", info[i].id);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 7);
+
+        if(info[i].current < 0)
+            puts("idle");
+        else
+            printf("%d", info[i].current);
+
+        VGA_moveCursorTo(VGA_getCurrentLine(), 16);
+        printf("%d", info[i].ready_count);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 23);
+        printf("%d", (uint32_t)info[i].context_switches);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 34);
+        printf("%d", (uint32_t)info[i].steals);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 42);
+        printf("%d\n", (uint32_t)info[i].idle_wakeups);
+    }
+}
+
+// the measure is done in ring 3 by /sysbench.bin, it prints its own results
+void sysbenchCommand(int argc, char** argv)
+{
+    if(!SYSCALL_hasSysenter())
+    {
+        puts("this cpu has no sysenter\n");
+        return;
+    }
+
+    create_process("/sysbench.bin", true);
+}
+
+void syscallstatCommand(int argc, char** argv)
+{
+    syscall_stats_t stats[SYSCALL_COUNT];
+    int count = SYSCALL_getStats(stats, SYSCALL_COUNT);
+
+    puts("  syscall      calls\n");
+
+    for(int i = 0; i < count; i++)
+    {
+        printf("  %s", stats[i].name);
+        VGA_moveCursorTo(VGA_getCurrentLine(), 15);
+        printf("%d\n", (uint32_t)stats[i].count);
+    }
+}
+
+// /aio.bin reads a file through its I/O rings, it prints its own results
+void aioCommand(int argc, char** argv)
+{
+    create_process("/aio.bin", true);
+}
+
+void elfCommand(int argc, char** argv)
+{
+    // the path is read by the new process, it must outlive the prompt
+    static char path[VFS_MAX_PATH_LENGTH];
+
+    if(argc > 2)
+    {
+        puts("usage: elf [path]\n");
+        return;
+    }
+
+    strcpy(path, argc == 2 ? argv[1] : "/bigbss.elf");
+    create_process(path, true);
+}
+
+void clockCommand(int argc, char** argv)
+{
+    if(argc == 2 && (strcmp(argv[1], "tsc") == 0 || strcmp(argv[1], "pit") == 0))
+    {
+        if(!CLOCK_setSource(strcmp(argv[1], "tsc") == 0 ? CLOCK_SOURCE_TSC : CLOCK_SOURCE_PIT))
+            puts("no calibrated time stamp counter\n");
+    }
+    else if(argc != 1)
+    {
+        puts("usage: clock [tsc|pit]\n");
+        return;
+    }
+
+    printf("source: %s\n", CLOCK_getSource() == CLOCK_SOURCE_TSC ? "tsc" : "pit (1ms)");
+
+    if(CLOCK_getTscKhz() != 0)
+        printf("tsc: %d khz, %s\n", CLOCK_getTscKhz(), CLOCK_hasInvariantTsc() ? "invariant" : "not invariant");
+
+    // the cost of a read, in cycles
+    uint64_t start = clock_cycles();
+    uint64_t now = clock_ns();
+    uint64_t cost = clock_cycles() - start;
+
+    printf("uptime: %llu ns (a read costs %llu cycles)\n", now, cost);
+}
+
+void traceCommand(int argc, char** argv)
+{
+    if(argc == 2 && strcmp(argv[1], "on") == 0)
+        TRACE_enable(true);
+    else if(argc == 2 && strcmp(argv[1], "off") == 0)
+        TRACE_enable(false);
+    else if(argc == 2 && strcmp(argv[1], "clear") == 0)
+    {
+        TRACE_enable(false);
+        TRACE_clear();
+    }
+    else if(argc == 2 && strcmp(argv[1], "dump") == 0)
+        TRACE_dump();
+    else if(argc != 1)
+    {
+        puts("usage: trace [on|off|clear|dump]\n");
+        return;
+    }
+
+    printf("tracing: %s\n", g_traceEnabled ? "on" : "off");
+    for(int i = 0; i < SMP_getCpuCount(); i++)
+        printf("cpu %d: %d events\n", i, TRACE_getCount(i));
+}
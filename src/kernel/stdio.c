@@ -43,8 +43,11 @@ char getchar()
 	// wait for a char keypress
 	while (key == NULL_KEY || ascii == NULL_KEY)
     {
-		key = KEYBOARD_getLastKey();
+		key = KEYBOARD_waitForKey();
         ascii = KEYBOARD_scanToAscii(key);
+
+        if (ascii == NULL_KEY)
+            KEYBOARD_discardLastKey();  // key release or non printable key, wait for the next one
     }
 
 	// discard last keypress (we handled it) and return
@@ -56,11 +59,12 @@ KEYCODE waitForKeyPress()
 {
     KEYCODE key = NULL_KEY;
 
-    KEYBOARD_discardLastKey();
+	// forget the keys typed before, we want a new key press
+	while (KEYBOARD_hasKey())
+		KEYBOARD_discardLastKey();
 
 	// wait for a keypress
-	while (key == NULL_KEY)
-		key = KEYBOARD_getLastKey();
+	key = KEYBOARD_waitForKey();
 
 	// discard last keypress (we handled it) and return
 	KEYBOARD_discardLastKey();
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <trace.h>
+#include <hal/io.h>
+#include <hal/smp.h>
+#include <hal/clock.h>
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DEFINITIONS / ENUMERATIONS / SIMPLE TYPEDEFS
+//============================================================================
+
+// one writer per ring (its own cpu with interrupts off), no lock needed
+typedef struct {
+    uint32_t head;              // free running, the slot is head & (TRACE_BUFFER_EVENTS - 1)
+    trace_record_t records[TRACE_BUFFER_EVENTS];
+} trace_ring_t;
+
+//============================================================================
+//    IMPLEMENTATION PRIVATE DATA
+//============================================================================
+
+volatile bool g_traceEnabled = false;
+
+static trace_ring_t g_traceRings[SMP_MAX_CPUS];
+
+//============================================================================
+//    INTERFACE FUNCTIONS
+//============================================================================
+
+void TRACE_record(uint16_t event, uint32_t arg1, uint32_t arg2)
+{
+    // no migration or nested tracepoint between taking the slot and filling it
+    uint32_t flags = disableInterruptsSave();
+
+    int cpu = SMP_getCpuIndex();
+    trace_ring_t* ring = &g_traceRings[cpu];
+    trace_record_t* record = &ring->records[ring->head & (TRACE_BUFFER_EVENTS - 1)];
+
+    record->timestamp = clock_cycles();
+    record->event = event;
+    record->cpu = cpu;
+    record->arg1 = arg1;
+    record->arg2 = arg2;
+    ring->head++;
+
+    restoreInterrupts(flags);
+}
+
+void TRACE_enable(bool enable)
+{
+    g_traceEnabled = enable;
+}
+
+// only while tracing is off, a writer could be in the middle of a record otherwise
+void TRACE_clear()
+{
+    for(int i = 0; i < SMP_MAX_CPUS; i++)
+        g_traceRings[i].head = 0;
+}
+
+uint32_t TRACE_getCount(int cpu)
+{
+    uint32_t head = g_traceRings[cpu].head;
+    return head < TRACE_BUFFER_EVENTS ? head : TRACE_BUFFER_EVENTS;
+}
+
+// one text line per record on debugcon, trace_decode.py turns them into a timeline
+// the header gives the tsc frequency, 0 when the timestamps are in ns (no tsc)
+void TRACE_dump()
+{
+    bool enabled = g_traceEnabled;
+    g_traceEnabled = false;
+
+    fprintf(VFS_FD_DEBUG, "#TRACE begin %d\n", CLOCK_getTscKhz());
+
+    for(int cpu = 0; cpu < SMP_getCpuCount(); cpu++)
+    {
+        trace_ring_t* ring = &g_traceRings[cpu];
+        uint32_t count = TRACE_getCount(cpu);
+
+        // oldest record first
+        for(uint32_t i = ring->head - count; i != ring->head; i++)
+        {
+            trace_record_t* record = &ring->records[i & (TRACE_BUFFER_EVENTS - 1)];
+            fprintf(VFS_FD_DEBUG, "#T %d %llu %d %x %x\n", record->cpu, record->timestamp, record->event, record->arg1, record->arg2);
+        }
+    }
+
+    fputs("#TRACE end\n", VFS_FD_DEBUG);
+    g_traceEnabled = enabled;
+}
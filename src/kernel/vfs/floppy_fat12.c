@@ -26,6 +26,8 @@
 #include <memmgr/vmalloc.h>
 #include <vfs/vfs.h>
 #include <drivers/fdc.h>
+#include <scheduler/multitask.h>
+#include <scheduler/waitqueue.h>
 
 #define MAX_VNODE_PER_VFS   16
 
@@ -90,10 +92,12 @@ typedef struct fat_dir_entry
 typedef struct fat12_info
 {
     vnode_t* total_vnode[MAX_VNODE_PER_VFS];
+    rwlock_t vnode_lock;    // total_vnode, lookups of cached vnodes run in parallel
     vnode_t* root_vnode;
     fat_BS_t *bootSector;
     void* file_allocation_table;
     void* fat_buffer;
+    mutex_t* buffer_lock;   // fat_buffer is shared by every reader of this mount
 }fs_info_t;
 
 int fat12_mount(vfs_t* mountpoint);
@@ -103,6 +107,7 @@ int fat12_get_root(vfs_t* mountpoint, vnode_t** result);
 int fat12_read(vnode_t* node, void *buffer, size_t size, uint32_t offset);
 int fat12_write(vnode_t* node, const void *buffer, size_t size, uint32_t offset);
 int fat12_lookup(vnode_t* node, const char* name, struct vnode** result);
+int fat12_getsize(vnode_t* node, uint32_t* size);
 
 filesystem_t fat12_op = {
     // fs_name will be filled later
@@ -116,6 +121,7 @@ vnodeops_t fat12_vnode_op = {
     .read = fat12_read,
     .write = fat12_write,
     .lookup = fat12_lookup,
+    .getsize = fat12_getsize,
 };
 
 void fat12_init()
@@ -142,7 +148,9 @@ int fat12_mount(vfs_t* mountpoint)
 
     for(int i = 0; i < MAX_VNODE_PER_VFS; i++)
         fs_info->total_vnode[i] = NULL;
-    
+
+    rwlock_init(&fs_info->vnode_lock);
+
     fat_BS_t *bootSector = kmalloc(sizeof(fat_BS_t));
     if(bootSector == NULL)
     {
@@ -174,6 +182,7 @@ int fat12_mount(vfs_t* mountpoint)
     // registering info ...
     fs_info->bootSector = bootSector;
     fs_info->fat_buffer = fat_buffer;
+    fs_info->buffer_lock = create_named_mutex("fat12 buffer");
     fs_info->file_allocation_table = file_allocation_table;
 
     fs_info->root_vnode = kmalloc(sizeof(vnode_t));
@@ -211,6 +220,7 @@ int fat12_unmount(vfs_t* mountpoint)
     kfree(fs_info->root_vnode);
     kfree(fs_info->bootSector);
     kfree(fs_info->fat_buffer);
+    destroy_mutex(fs_info->buffer_lock);
     vfree(fs_info->file_allocation_table);
     kfree(fs_info);
     
@@ -244,6 +254,15 @@ uint32_t cluster_to_Lba(uint32_t cluster, fat_BS_t* bootSector)
     return (bootSector->reserved_sector_count + fat_total_size + root_dir_size) + (cluster - 2) * bootSector->sectors_per_cluster;
 }
 
+int fat12_getsize(vnode_t* node, uint32_t* size)
+{
+    if(node->vnode_type != VREG)
+        return VFS_EISDIR;
+
+    *size = ((fat_dir_entry_t*)node->vnode_data)->fileSize;
+    return VFS_OK;
+}
+
 int fat12_read(vnode_t* node, void *buffer, size_t size, uint32_t offset)
 {
     if(node->vnode_type != VREG)
@@ -269,6 +288,9 @@ int fat12_read(vnode_t* node, void *buffer, size_t size, uint32_t offset)
     /* This is an offset based on the cluster currently being read, hence the name 'hypothetical'. */
     uint32_t hypothetical_offset = offset - (skippedClusters * fs_info->bootSector->sectors_per_cluster * fs_info->bootSector->bytes_per_sector);
     size_t to_read = 0; // to keep track of how many byte we've read
+
+    acquire_mutex(fs_info->buffer_lock);
+
     while (currentCluster < 0xFF8 && to_read < size)
     {
         FDC_readSectors(fs_info->fat_buffer, cluster_to_Lba(currentCluster, fs_info->bootSector), fs_info->bootSector->sectors_per_cluster);
@@ -283,6 +305,8 @@ int fat12_read(vnode_t* node, void *buffer, size_t size, uint32_t offset)
         hypothetical_offset = 0;    // the hypothetical offset reset to 0 for the next cluster !
         currentCluster = get_next_cluster(currentCluster, fs_info->file_allocation_table);
     }
+
+    release_mutex(fs_info->buffer_lock);
     
     return to_read; // return the number of byte read !
 }
@@ -297,11 +321,8 @@ int fat12_write(vnode_t* node, const void *buffer, size_t size, uint32_t offset)
     return 0;   // unfortunately I haven't implemented this yet !
 }
 
-static vnode_t* create_vnode(vfs_t* mountpoint, fat_dir_entry_t* inode_info)
+static vnode_t* find_cached_vnode(fs_info_t* fs_info, fat_dir_entry_t* inode_info)
 {
-    fs_info_t* fs_info = (fs_info_t*)mountpoint->vfs_data;
-
-    /* Here we try to determine if the vnode of the target element is already present in the cache. */
     for(int i = 0; i < MAX_VNODE_PER_VFS; i++)
     {
         if(fs_info->total_vnode[i] != NULL)
@@ -313,6 +334,41 @@ static vnode_t* create_vnode(vfs_t* mountpoint, fat_dir_entry_t* inode_info)
         }
     }
 
+    return NULL;
+}
+
+/*
+ * Returns the vnode of a directory entry with a reference held. A hit
+ * only needs the cache read lock, the write lock is taken to insert.
+ */
+static vnode_t* create_vnode(vfs_t* mountpoint, fat_dir_entry_t* inode_info)
+{
+    fs_info_t* fs_info = (fs_info_t*)mountpoint->vfs_data;
+    vnode_t* cached;
+
+    /* Here we try to determine if the vnode of the target element is already present in the cache. */
+    read_lock(&fs_info->vnode_lock);
+
+    cached = find_cached_vnode(fs_info, inode_info);
+    if(cached != NULL)
+        VFS_hold_vnode(cached);
+
+    read_unlock(&fs_info->vnode_lock);
+
+    if(cached != NULL)
+        return cached;
+
+    write_lock(&fs_info->vnode_lock);
+
+    // another task may have inserted it while we were not holding the lock
+    cached = find_cached_vnode(fs_info, inode_info);
+    if(cached != NULL)
+    {
+        VFS_hold_vnode(cached);
+        write_unlock(&fs_info->vnode_lock);
+        return cached;
+    }
+
     /* Otherwise, we create a new vnode and ensure that we also generate a new inode,
     since the one we received is temporary (as it came from the FAT buffer). */
     fat_dir_entry_t* file_inode = kmalloc(sizeof(fat_dir_entry_t));
@@ -337,6 +393,8 @@ static vnode_t* create_vnode(vfs_t* mountpoint, fat_dir_entry_t* inode_info)
         if(fs_info->total_vnode[i] == NULL)
         {
             fs_info->total_vnode[i] = newVnode;
+            VFS_hold_vnode(newVnode);
+            write_unlock(&fs_info->vnode_lock);
             return newVnode;
         } 
 
@@ -347,10 +405,14 @@ static vnode_t* create_vnode(vfs_t* mountpoint, fat_dir_entry_t* inode_info)
             kfree(fs_info->total_vnode[i]);
 
             fs_info->total_vnode[i] = newVnode;
+            VFS_hold_vnode(newVnode);
+            write_unlock(&fs_info->vnode_lock);
             return newVnode;
         }
     }
 
+    write_unlock(&fs_info->vnode_lock);
+
     kfree(newVnode->vnode_data); // free the inode !
     kfree(newVnode);
     return NULL;    // cannot create vnode because too many vnodes are in used
@@ -403,10 +465,13 @@ int fat12_lookup(vnode_t* node, const char* name, struct vnode** result)
     
     fat_dir_entry_t* inode = node->vnode_data;
     fs_info_t* fs_info = node->vnode_vfs->vfs_data;
+    fat_dir_entry_t entry;  // the entry points into fat_buffer, copy it before releasing the buffer
     
     char fatName[12];
     string_to_fatname(name, fatName);
 
+    acquire_mutex(fs_info->buffer_lock);
+
     // here we need to look either on the root directory or another directory
     if((node->flags & VNODE_ROOT) == VNODE_ROOT)
     {
@@ -439,10 +504,15 @@ int fat12_lookup(vnode_t* node, const char* name, struct vnode** result)
         }
     }
 
+    if(inode != NULL)
+        memcpy(&entry, inode, sizeof(fat_dir_entry_t));
+
+    release_mutex(fs_info->buffer_lock);
+
     if(inode != NULL)
     {
-        *result = create_vnode(node->vnode_vfs, inode);
-        return VFS_OK;
+        *result = create_vnode(node->vnode_vfs, &entry);   // held, the caller releases it
+        return *result != NULL ? VFS_OK : VFS_ENFILE;
     }
 
     *result = NULL;
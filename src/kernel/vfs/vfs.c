@@ -22,6 +22,8 @@
 #include <drivers/e9_port.h>
 #include <memmgr/heap.h>
 #include <string.h>
+#include <scheduler/multitask.h>
+#include <scheduler/waitqueue.h>
 
 #include <vfs/vfs.h>
 #include "floppy_fat12.h"
@@ -42,6 +44,9 @@ filesystem_t *registered_fs[VFS_MAX_FS];
 int num_registered_fs;
 vfs_file_t vfs_open_files[MAX_OPEN_FILES];
 
+rwlock_t mount_lock;	// mount list and the VFS_mountedhere links, lookups only read them
+rwlock_t files_lock;	// vfs_open_files
+
 //============================================================================
 //    IMPLEMENTATION PRIVATE FUNCTIONS
 //============================================================================
@@ -63,12 +68,19 @@ static void add_mount_point(vfs_t *mountpoint)
 
 static void remove_mount_point(vfs_t *mountpoint)
 {
+	if(vfs_root == mountpoint)
+	{
+		vfs_root = mountpoint->next;
+		return;
+	}
+
 	vfs_t *current = vfs_root;
 
-	while (current->next != mountpoint)
+	while (current != NULL && current->next != mountpoint)
 		current = current->next;
 
-	current->next = mountpoint;
+	if(current != NULL)
+		current->next = mountpoint->next;
 }
 
  static filesystem_t *find_filesystem_by_name(const char *name)
@@ -122,14 +134,50 @@ void VFS_init()
 	for(int i = 0; i < MAX_OPEN_FILES; i++)
 		vfs_open_files[i].vnode = NULL;
 
+	rwlock_init(&mount_lock);
+	rwlock_init(&files_lock);
+
 	log_info("kernel", "Initializing floppy FAT12...");
 
     fat12_init();
 }
 
+// the reference count is only touched with interrupts off, lookups run in parallel
+void VFS_hold_vnode(vnode_t* vnode)
+{
+	lock_sheduler();
+	vnode->ref_count++;
+	unlock_sheduler();
+}
+
+void VFS_release_vnode(vnode_t* vnode)
+{
+	lock_sheduler();
+	if(vnode->ref_count > 0)
+		vnode->ref_count--;
+	unlock_sheduler();
+}
+
+// go from a covered vnode to the root of the filesystem mounted on it
+static vnode_t* cross_mount_point(vnode_t* node)
+{
+	vnode_t* root;
+
+	node->VFS_mountedhere->vfs_op->get_root(node->VFS_mountedhere, &root);
+	VFS_hold_vnode(root);
+	VFS_release_vnode(node);
+
+	return root;
+}
+
+/*
+ * Resolve an absolute path. The vnode is returned with a reference held
+ * (the lookup operation returns held vnodes too), the caller releases it.
+ */
 vnode_t* lookup_path_name(const char* path)
 {
 	vnode_t* node_out = NULL;
+	vnode_t* next_node;
 	char parsed_path[VFS_MAX_PATH_LENGTH];
 	char* name;
     char* next_name;
@@ -139,14 +187,23 @@ vnode_t* lookup_path_name(const char* path)
 
 	strcpy(parsed_path, path);
 
+	read_lock(&mount_lock);
+
+	if(vfs_root == NULL)
+	{
+		read_unlock(&mount_lock);
+		return NULL;
+	}
+
 	vfs_root->vfs_op->get_root(vfs_root, &node_out);
+	VFS_hold_vnode(node_out);
 	name = parsed_path + 1;   // ignore the first '/'
     next_name = name;
 
 	while(node_out != NULL && *name != '\0')
 	{
 		if(node_out->VFS_mountedhere != NULL) // if this is a mountpoint
-			node_out->VFS_mountedhere->vfs_op->get_root(node_out->VFS_mountedhere, &node_out);
+			node_out = cross_mount_point(node_out);
 
         next_name = (char*)strchr(next_name, '/');
         if(next_name != NULL)
@@ -160,7 +217,9 @@ vnode_t* lookup_path_name(const char* path)
                 next_name++;
         }
 
-		node_out->vnode_op->lookup(node_out, name, &node_out);
+		node_out->vnode_op->lookup(node_out, name, &next_node);
+		VFS_release_vnode(node_out);
+		node_out = next_node;
 		name = next_name;
 	}
 
@@ -171,8 +230,10 @@ vnode_t* lookup_path_name(const char* path)
 	//	return NULL;
 
 	if(node_out != NULL && node_out->VFS_mountedhere != NULL) // if this is a mountpoint
-			node_out->VFS_mountedhere->vfs_op->get_root(node_out->VFS_mountedhere, &node_out);
-	
+			node_out = cross_mount_point(node_out);
+
+	read_unlock(&mount_lock);
+
 	return node_out;
 }
 
@@ -190,34 +251,64 @@ int VFS_mount(const char *fs_name, const char *mount_point)
 
 	new_vfs->next = NULL;
 	new_vfs->vfs_op = fs;
+	new_vfs->vnodecovered = NULL;
 
-	if(vfs_root == NULL)	// is this the first mount point ?
-		new_vfs->vnodecovered = NULL;
-	else
+	if(vfs_root != NULL)	// is this the first mount point ?
 	{
-		// find the vnode's mountpoint
+		// find the vnode's mountpoint, we keep the reference for as long as it is covered
 		new_vfs->vnodecovered = lookup_path_name(mount_point);
-		if(new_vfs->vnodecovered == NULL || (new_vfs->vnodecovered->flags & VNODE_ROOT) == VNODE_ROOT)
+		if(new_vfs->vnodecovered == NULL)
+		{
+			kfree(new_vfs);
+			return VFS_ENOENT;
+		}
+
+		if((new_vfs->vnodecovered->flags & VNODE_ROOT) == VNODE_ROOT)
 		{
+			VFS_release_vnode(new_vfs->vnodecovered);
 			kfree(new_vfs);
 			return VFS_ENOENT;
 		}
 
 		if(new_vfs->vnodecovered->vnode_type != VDIR)
 		{
+			VFS_release_vnode(new_vfs->vnodecovered);
 			kfree(new_vfs);
 			return VFS_ENOTDIR;
 		}
-
-		new_vfs->vnodecovered->ref_count++;
-		new_vfs->vnodecovered->VFS_mountedhere = new_vfs;
 	}
 
+	// read the device before taking the lock, lookups keep going meanwhile
 	if(new_vfs->vfs_op->VFS_mount(new_vfs) != VFS_OK)
+	{
+		if(new_vfs->vnodecovered != NULL)
+			VFS_release_vnode(new_vfs->vnodecovered);
+
+		kfree(new_vfs);
         return VFS_ERROR;
-    
+	}
+
+	write_lock(&mount_lock);
+
+	if(new_vfs->vnodecovered != NULL)
+	{
+		if(new_vfs->vnodecovered->VFS_mountedhere != NULL)
+		{
+			// someone mounted something here in the meantime
+			write_unlock(&mount_lock);
+			new_vfs->vfs_op->VFS_unmount(new_vfs);
+			VFS_release_vnode(new_vfs->vnodecovered);
+			kfree(new_vfs);
+			return VFS_EEXIST;
+		}
+
+		new_vfs->vnodecovered->VFS_mountedhere = new_vfs;
+	}
+
 	add_mount_point(new_vfs);
 
+	write_unlock(&mount_lock);
+
 	return VFS_OK;	// ok
 }
 
@@ -227,10 +318,12 @@ int VFS_mount(const char *fs_name, const char *mount_point)
 	if(vnode == NULL)
 		return VFS_ENOENT;
 
-	if((vnode->flags & VNODE_ROOT) != VNODE_ROOT)
-		return VFS_ERROR; // it's not the root of a filesystem, it's not a mount point...
-
 	vfs_t* mountpoint = vnode->vnode_vfs;
+	bool is_root = (vnode->flags & VNODE_ROOT) == VNODE_ROOT;
+	VFS_release_vnode(vnode);
+
+	if(!is_root)
+		return VFS_ERROR; // it's not the root of a filesystem, it's not a mount point...
 
 	if (mountpoint == vfs_root)
          return VFS_EACCESS;  // cannot unmount the root fs
@@ -238,12 +331,16 @@ int VFS_mount(const char *fs_name, const char *mount_point)
 	// TODO: implemente a mechanism to prevent umounting a filesystem
 	// as long as there are other filesystems mounted on top of it
 
+	write_lock(&mount_lock);
+
 	// this vnode is no longer a mountpoint
 	mountpoint->vnodecovered->VFS_mountedhere = NULL;
-	mountpoint->vnodecovered->ref_count--;
+	remove_mount_point(mountpoint);
+
+	write_unlock(&mount_lock);
 
+	VFS_release_vnode(mountpoint->vnodecovered);
 	mountpoint->vfs_op->VFS_unmount(mountpoint);
-	remove_mount_point(mountpoint);
 	kfree(mountpoint);
 
     return VFS_OK;
@@ -251,58 +348,192 @@ int VFS_mount(const char *fs_name, const char *mount_point)
 
  fd_t VFS_open(const char *path, uint16_t mode)
  {
-	vnode_t* file_node = lookup_path_name(path);
+	vnode_t* file_node = lookup_path_name(path);	// the reference goes to the descriptor
 
 	if(file_node == NULL)
 		return VFS_ENOENT;
 
 	if(file_node->vnode_type != VREG)
+	{
+		VFS_release_vnode(file_node);
 		return VFS_EISDIR;
+	}
+
+	write_lock(&files_lock);
 
 	fd_t descriptor = find_free_fd();
 	if(descriptor == VFS_ENFILE)
+	{
+		write_unlock(&files_lock);
+		VFS_release_vnode(file_node);
 		return VFS_ENFILE;
-
-	file_node->ref_count++;
+	}
 
 	vfs_open_files[descriptor].mode = mode;
 	vfs_open_files[descriptor].position = 0;
 	vfs_open_files[descriptor].vnode = file_node;
 
+	write_unlock(&files_lock);
+
 	return descriptor;
  }
 
 int VFS_close(fd_t descriptor)
 {
+	write_lock(&files_lock);
+
 	if(!is_fd_valid(descriptor))
+	{
+		write_unlock(&files_lock);
 		return VFS_EBADF;
+	}
 
-	vfs_open_files[descriptor].vnode->ref_count--;
+	vnode_t* vnode = vfs_open_files[descriptor].vnode;
 	vfs_open_files[descriptor].vnode = NULL;
 
+	write_unlock(&files_lock);
+
+	VFS_release_vnode(vnode);
+
     return VFS_OK;
 }
 
-size_t VFS_read(fd_t fd, void *buffer, size_t size)
+/*
+ * Take a copy of an open file under the fd table lock, with a reference on
+ * its vnode so a concurrent close can't free it during the transfer.
+ * A transfer claims [position, position + claim) right away: two users of the
+ * same fd (a process and its ioring worker) never get the same offset.
+ */
+static int get_open_file(fd_t fd, vfs_file_t* file, uint32_t claim)
 {
+	if(claim > 0)
+		write_lock(&files_lock);
+	else
+		read_lock(&files_lock);
+
 	if(!is_fd_valid(fd))
+	{
+		if(claim > 0)
+			write_unlock(&files_lock);
+		else
+			read_unlock(&files_lock);
 		return VFS_EBADF;
+	}
 
-	if(vfs_open_files[fd].mode != VFS_O_RDONLY && vfs_open_files[fd].mode != VFS_O_RDWR)
-		return VFS_EACCESS;
+	*file = vfs_open_files[fd];
+	VFS_hold_vnode(file->vnode);
+
+	if(claim > 0)
+	{
+		vfs_open_files[fd].position += claim;
+		write_unlock(&files_lock);
+	}
+	else
+		read_unlock(&files_lock);
+
+	return VFS_OK;
+}
+
+/*
+ * Give back the part of the claim that wasn't transferred, unless the position
+ * moved since (another claim or an lseek): it then stays where they left it.
+ */
+static void put_open_file(fd_t fd, vfs_file_t* file, uint32_t claim, int transferred)
+{
+	uint32_t done = transferred > 0 ? transferred : 0;
+
+	if(done < claim)
+	{
+		write_lock(&files_lock);
+
+		if(vfs_open_files[fd].vnode == file->vnode && vfs_open_files[fd].position == file->position + claim)
+			vfs_open_files[fd].position = file->position + done;
+
+		write_unlock(&files_lock);
+	}
+
+	VFS_release_vnode(file->vnode);
+}
+
+size_t VFS_read(fd_t fd, void *buffer, size_t size)
+{
+	vfs_file_t file;
+
+	if(get_open_file(fd, &file, size) != VFS_OK)
+		return VFS_EBADF;
 
-	int ret = vfs_open_files[fd].vnode->vnode_op->read(vfs_open_files[fd].vnode, buffer, size, vfs_open_files[fd].position);
+	if(file.mode != VFS_O_RDONLY && file.mode != VFS_O_RDWR)
+	{
+		put_open_file(fd, &file, size, 0);
+		return VFS_EACCESS;
+	}
 
-	if(ret < 0)	// it's an error
-		return ret;
+	int ret = file.vnode->vnode_op->read(file.vnode, buffer, size, file.position);
 
-	vfs_open_files[fd].position += ret;
+	put_open_file(fd, &file, size, ret);
 
 	return ret;
 }
 
+// returns the new position, it may go past the end of the file (reads return 0 there)
+int VFS_lseek(fd_t fd, int32_t offset, int whence)
+{
+	vfs_file_t file;
+	int32_t base;
+
+	if(get_open_file(fd, &file, 0) != VFS_OK)
+		return VFS_EBADF;
+
+	switch (whence)
+	{
+	case VFS_SEEK_SET:
+		base = 0;
+		break;
+
+	case VFS_SEEK_CUR:
+		base = file.position;
+		break;
+
+	case VFS_SEEK_END:
+	{
+		uint32_t size;
+
+		if(file.vnode->vnode_op->getsize == NULL || file.vnode->vnode_op->getsize(file.vnode, &size) != VFS_OK)
+		{
+			put_open_file(fd, &file, 0, 0);
+			return VFS_EINVAL;
+		}
+
+		base = size;
+		break;
+	}
+
+	default:
+		put_open_file(fd, &file, 0, 0);
+		return VFS_EINVAL;
+	}
+
+	if(base + offset < 0)
+	{
+		put_open_file(fd, &file, 0, 0);
+		return VFS_EINVAL;
+	}
+
+	write_lock(&files_lock);
+
+	if(vfs_open_files[fd].vnode == file.vnode)
+		vfs_open_files[fd].position = base + offset;
+
+	write_unlock(&files_lock);
+
+	put_open_file(fd, &file, 0, 0);
+	return base + offset;
+}
+
 size_t VFS_write(fd_t fd, const void *buffer, size_t size)
 {
+	vfs_file_t file;
+
 	switch (fd)
     {
     case VFS_FD_STDOUT:
@@ -319,18 +550,18 @@ size_t VFS_write(fd_t fd, const void *buffer, size_t size)
 
 	// else here:
 
-	if(!is_fd_valid(fd))
+	if(get_open_file(fd, &file, size) != VFS_OK)
 		return VFS_EBADF;
 
-	if(vfs_open_files[fd].mode != VFS_O_WRONLY && vfs_open_files[fd].mode != VFS_O_RDWR)
+	if(file.mode != VFS_O_WRONLY && file.mode != VFS_O_RDWR)
+	{
+		put_open_file(fd, &file, size, 0);
 		return VFS_EACCESS;
+	}
 
-	int ret = vfs_open_files[fd].vnode->vnode_op->write(vfs_open_files[fd].vnode, buffer, size, vfs_open_files[fd].position);
-	
-	if(ret < 0)	// it's an error
-		return ret;
+	int ret = file.vnode->vnode_op->write(file.vnode, buffer, size, file.position);
 
-	vfs_open_files[fd].position += ret;
+	put_open_file(fd, &file, size, ret);
 
 	return ret;
 }
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ring_buffer.h"
+
+// on x86 aligned 32 bit loads and stores are atomic and stores are not reordered
+// with other stores, acquire/release only keeps the compiler from moving accesses
+#define LOAD_ACQUIRE(ptr)           __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(ptr, value)   __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+
+static void copy_elem(uint8_t* dst, const uint8_t* src, uint32_t size)
+{
+    for(uint32_t i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+bool ring_buffer_init(ring_buffer_t* rb, void* storage, uint32_t elem_size, uint32_t capacity)
+{
+    if(storage == NULL || elem_size == 0 || capacity == 0 || (capacity & (capacity - 1)) != 0)
+        return false;   // the capacity must be a power of two
+
+    rb->data = storage;
+    rb->elem_size = elem_size;
+    rb->mask = capacity - 1;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->dropped = 0;
+
+    return true;
+}
+
+bool ring_buffer_push(ring_buffer_t* rb, const void* elem)
+{
+    uint32_t head = rb->head;
+    uint32_t tail = LOAD_ACQUIRE(&rb->tail);
+
+    if(head - tail > rb->mask)
+    {
+        rb->dropped++;
+        return false;   // full
+    }
+
+    copy_elem(rb->data + (head & rb->mask) * rb->elem_size, elem, rb->elem_size);
+
+    // publish the element only once it is written
+    STORE_RELEASE(&rb->head, head + 1);
+    return true;
+}
+
+bool ring_buffer_peek(ring_buffer_t* rb, void* elem)
+{
+    uint32_t tail = rb->tail;
+
+    if(LOAD_ACQUIRE(&rb->head) == tail)
+        return false;   // empty
+
+    copy_elem(elem, rb->data + (tail & rb->mask) * rb->elem_size, rb->elem_size);
+    return true;
+}
+
+bool ring_buffer_pop(ring_buffer_t* rb, void* elem)
+{
+    if(!ring_buffer_peek(rb, elem))
+        return false;
+
+    // the slot can be reused by the producer once tail moved past it
+    STORE_RELEASE(&rb->tail, rb->tail + 1);
+    return true;
+}
+
+uint32_t ring_buffer_count(ring_buffer_t* rb)
+{
+    return LOAD_ACQUIRE(&rb->head) - LOAD_ACQUIRE(&rb->tail);
+}
+
+bool ring_buffer_empty(ring_buffer_t* rb)
+{
+    return ring_buffer_count(rb) == 0;
+}
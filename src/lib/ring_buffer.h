@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2025,  Novice
+ *
+ * This file is part of the Novix software.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Single producer / single consumer ring buffer. The producer (typically
+ * an irq handler) only writes 'head', the consumer only writes 'tail', so
+ * neither side needs a lock or to disable interrupts. The indices run
+ * freely and are masked on access, the capacity must be a power of two.
+ */
+typedef struct ring_buffer
+{
+    uint8_t* data;
+    uint32_t elem_size;
+    uint32_t mask;          // capacity - 1
+    uint32_t head;          // next slot to write, producer only
+    uint32_t tail;          // next slot to read, consumer only
+    uint32_t dropped;       // pushes refused because the buffer was full, producer only
+}ring_buffer_t;
+
+bool ring_buffer_init(ring_buffer_t* rb, void* storage, uint32_t elem_size, uint32_t capacity);
+
+// producer side
+bool ring_buffer_push(ring_buffer_t* rb, const void* elem);
+
+// consumer side
+bool ring_buffer_pop(ring_buffer_t* rb, void* elem);
+bool ring_buffer_peek(ring_buffer_t* rb, void* elem);
+
+// either side, the result may be stale as soon as it is returned
+uint32_t ring_buffer_count(ring_buffer_t* rb);
+bool ring_buffer_empty(ring_buffer_t* rb);
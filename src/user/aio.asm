@@ -0,0 +1,119 @@
+org 0x400000
+bits 32
+
+; read a file through the I/O rings and keep computing until the data is there
+
+SYSCALL_PRINT equ 1
+SYSCALL_EXIT  equ 2
+SYSCALL_OPEN  equ 3
+SYSCALL_READ  equ 4
+SYSCALL_CLOSE equ 6
+
+VFS_O_RDONLY  equ 1
+
+main:
+    call ioring_setup
+    cmp eax, -4096              ; the ring page is above 2 GB, only small negatives are errors
+    jae .failed
+
+    ; open, and wait for it: the fd is needed by the read
+    call ioring_get_sqe
+    mov dword [edi + SQE_OPCODE], SYSCALL_OPEN
+    mov dword [edi + SQE_ARG1], path
+    mov dword [edi + SQE_ARG2], VFS_O_RDONLY
+    mov dword [edi + SQE_USER_DATA], SYSCALL_OPEN
+    call ioring_queue_sqe
+
+    mov ebx, 1
+    call ioring_enter
+    call ioring_reap
+    test edx, edx
+    js .failed
+    mov [fd], edx
+
+    ; read then close in one submission
+    call ioring_get_sqe
+    mov dword [edi + SQE_OPCODE], SYSCALL_READ
+    mov edx, [fd]
+    mov [edi + SQE_FD], edx
+    mov dword [edi + SQE_ARG1], buffer
+    mov dword [edi + SQE_ARG2], BUFFER_SIZE - 1
+    mov dword [edi + SQE_USER_DATA], SYSCALL_READ
+    call ioring_queue_sqe
+
+    call ioring_get_sqe
+    mov dword [edi + SQE_OPCODE], SYSCALL_CLOSE
+    mov edx, [fd]
+    mov [edi + SQE_FD], edx
+    mov dword [edi + SQE_USER_DATA], SYSCALL_CLOSE
+    call ioring_queue_sqe
+
+    xor ebx, ebx                ; only kick the worker
+    call ioring_enter
+
+.compute:
+    inc dword [spins]           ; the work done while the floppy reads
+    call ioring_reap
+    jc .compute
+    cmp eax, SYSCALL_READ
+    jne .compute
+
+    test edx, edx
+    js .failed
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, buffer
+    int 0x80
+
+    mov ebx, 1                  ; the close
+    call ioring_enter
+    call ioring_reap
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, spins_label
+    int 0x80
+
+    mov eax, [spins]
+    call print_number
+    jmp .exit
+
+.failed:
+    mov eax, SYSCALL_PRINT
+    mov ebx, failed_label
+    int 0x80
+
+.exit:
+    mov eax, SYSCALL_EXIT
+    int 0x80
+
+; eax = number to print
+print_number:
+    mov edi, number_end
+    mov ecx, 10
+
+.digit:
+    xor edx, edx
+    div ecx
+    add dl, '0'
+    dec edi
+    mov [edi], dl
+    test eax, eax
+    jnz .digit
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, edi
+    int 0x80
+    ret
+
+%include "ioring.inc"
+
+BUFFER_SIZE     equ 256
+
+fd              dd 0
+spins           dd 0
+path            db "/mydir/test_msg.txt", 0
+spins_label     db "loops run during the read: ", 0
+failed_label    db "asynchronous read failed", 10, 0
+number          times 10 db 0
+number_end      db 10, 0
+buffer          times BUFFER_SIZE db 0
@@ -0,0 +1,51 @@
+bits 32
+
+; ELF program with a 4 MB bss: it starts at once and only the pages it
+; touches are ever loaded (demand paging)
+
+SYSCALL_PRINT equ 1
+SYSCALL_EXIT  equ 2
+
+BSS_SIZE      equ 4 * 1024 * 1024
+STRIDE        equ 1024 * 1024
+
+section .text
+global main
+main:
+    mov eax, SYSCALL_PRINT
+    mov ebx, started_label
+    int 0x80
+
+    ; one page per megabyte: the first access zero fills it
+    mov esi, big_buffer
+    mov ecx, BSS_SIZE / STRIDE
+
+.touch:
+    cmp dword [esi], 0
+    jne .not_zero
+    mov dword [esi], ecx
+    add esi, STRIDE
+    dec ecx
+    jnz .touch
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, done_label
+    int 0x80
+    jmp .exit
+
+.not_zero:
+    mov eax, SYSCALL_PRINT
+    mov ebx, dirty_label
+    int 0x80
+
+.exit:
+    mov eax, SYSCALL_EXIT
+    int 0x80
+
+section .data
+started_label   db "ELF program running, nothing of its 4 MB bss is mapped yet", 10, 0
+done_label      db "touched 4 pages of the bss, all zero filled on demand", 10, 0
+dirty_label     db "a fresh bss page was not zero!", 10, 0
+
+section .bss
+big_buffer      resb BSS_SIZE
@@ -0,0 +1,78 @@
+bits 32
+
+; ELF program using the user allocator (malloc.inc): the heap grows through
+; brk, then freed blocks are recycled without any syscall
+
+SYSCALL_PRINT equ 1
+SYSCALL_EXIT  equ 2
+
+BLOCKS        equ 1000
+BLOCK_SIZE    equ 24
+
+section .text
+global main
+main:
+    ; fill the table with fresh blocks
+    xor esi, esi
+
+.allocate:
+    mov ecx, BLOCK_SIZE
+    call malloc
+    test eax, eax
+    jz .failed
+    mov [blocks + esi * 4], eax
+    mov [eax], esi                  ; the memory is usable
+    inc esi
+    cmp esi, BLOCKS
+    jne .allocate
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, allocated_label
+    int 0x80
+
+    ; give them all back
+    xor esi, esi
+
+.free:
+    mov eax, [blocks + esi * 4]
+    call free
+    inc esi
+    cmp esi, BLOCKS
+    jne .free
+
+    ; the same class comes back from the free list, last freed first
+    mov ecx, BLOCK_SIZE
+    call malloc
+    cmp eax, [blocks + (BLOCKS - 1) * 4]
+    jne .failed
+
+    ; bigger than the classes: mmap'ed
+    mov ecx, 0x10000
+    call malloc
+    test eax, eax
+    jz .failed
+    mov dword [eax + 0xFFF0], 0x12345678
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, done_label
+    int 0x80
+    jmp .exit
+
+.failed:
+    mov eax, SYSCALL_PRINT
+    mov ebx, failed_label
+    int 0x80
+
+.exit:
+    mov eax, SYSCALL_EXIT
+    int 0x80
+
+%include "malloc.inc"
+
+section .data
+allocated_label db "1000 blocks allocated on the heap", 10, 0
+done_label      db "freed blocks recycled, large block mmap'ed", 10, 0
+failed_label    db "allocator test failed", 10, 0
+
+section .bss
+blocks          resd BLOCKS
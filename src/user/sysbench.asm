@@ -0,0 +1,157 @@
+org 0x400000
+bits 32
+
+; null syscall round trips through int 0x80 and through sysenter, in tsc cycles,
+; then the pid and the time read from the info pages without a syscall
+
+ITERATIONS equ 10000
+
+SYSCALL_NULL  equ 0
+SYSCALL_PRINT equ 1
+SYSCALL_EXIT  equ 2
+SYSCALL_GETPID equ 12
+
+CPUID_SEP     equ 1 << 11       ; leaf 1, edx: sysenter/sysexit
+
+main:
+    mov eax, SYSCALL_PRINT
+    mov ebx, int80_label
+    int 0x80
+
+    rdtsc
+    mov [start], eax
+    mov esi, ITERATIONS
+
+.int80_loop:
+    mov eax, SYSCALL_NULL
+    int 0x80
+    dec esi
+    jnz .int80_loop
+
+    rdtsc
+    sub eax, [start]
+    call print_average
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, sysenter_label
+    int 0x80
+
+    ; the kernel only sets sysenter up when the cpu has it, #UD otherwise
+    mov eax, 1
+    cpuid
+    test edx, CPUID_SEP
+    jnz .sysenter_bench
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, unsupported_label
+    int 0x80
+    jmp .getpid_bench
+
+.sysenter_bench:
+    rdtsc
+    mov [start], eax
+    mov esi, ITERATIONS
+
+.sysenter_loop:
+    mov eax, SYSCALL_NULL
+    mov ecx, esp                ; sysexit returns on this stack
+    mov edx, .sysenter_return   ; and at this address
+    sysenter
+.sysenter_return:
+    dec esi
+    jnz .sysenter_loop
+
+    rdtsc
+    sub eax, [start]
+    call print_average
+
+.getpid_bench:
+    mov eax, SYSCALL_PRINT
+    mov ebx, getpid_label
+    int 0x80
+
+    rdtsc
+    mov [start], eax
+    mov esi, ITERATIONS
+
+.getpid_loop:
+    mov eax, SYSCALL_GETPID
+    int 0x80
+    dec esi
+    jnz .getpid_loop
+
+    rdtsc
+    sub eax, [start]
+    call print_average
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, infopid_label
+    int 0x80
+
+    rdtsc
+    mov [start], eax
+    mov esi, ITERATIONS
+
+.infopid_loop:
+    call userinfo_getpid
+    dec esi
+    jnz .infopid_loop
+
+    rdtsc
+    sub eax, [start]
+    call print_average
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, time_label
+    int 0x80
+
+    rdtsc
+    mov [start], eax
+    mov esi, ITERATIONS
+
+.time_loop:
+    call userinfo_time_ms
+    dec esi
+    jnz .time_loop
+
+    rdtsc
+    sub eax, [start]
+    call print_average
+
+    mov eax, SYSCALL_EXIT
+    int 0x80
+
+; eax = total cycles of the loop
+print_average:
+    xor edx, edx
+    mov ecx, ITERATIONS
+    div ecx
+
+    mov edi, number_end
+    mov ecx, 10
+
+.digit:
+    xor edx, edx
+    div ecx
+    add dl, '0'
+    dec edi
+    mov [edi], dl
+    test eax, eax
+    jnz .digit
+
+    mov eax, SYSCALL_PRINT
+    mov ebx, edi
+    int 0x80
+    ret
+
+%include "userinfo.inc"
+
+start           dd 0
+int80_label     db "int 0x80 null syscall: ", 0
+sysenter_label  db "sysenter null syscall: ", 0
+getpid_label    db "getpid syscall: ", 0
+infopid_label   db "getpid from the info page: ", 0
+time_label      db "time from the info page: ", 0
+unsupported_label db "not supported", 10, 0
+number          times 10 db 0
+number_end      db " cycles", 10, 0
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+#
+# Decode a kernel trace dump ("trace dump" in the shell) from the debugcon output.
+#
+#   ./run.sh | tee debugcon.log
+#   python3 trace_decode.py debugcon.log            # timeline + summary
+#   python3 trace_decode.py debugcon.log -c out.json  # chrome://tracing / perfetto
+#
+# The kernel writes "#TRACE begin <tsc khz>", one "#T cpu timestamp event arg1 arg2" line
+# per record (args in hex), then "#TRACE end". Only the last dump of the log is used.
+# The timestamps are tsc cycles, or nanoseconds when the header says 0 khz (no tsc).
+
+import argparse
+import json
+import re
+import sys
+
+EVENTS = {
+    1: "switch",
+    2: "irq_entry",
+    3: "irq_exit",
+    4: "syscall_entry",
+    5: "syscall_exit",
+    6: "page_fault",
+    7: "kmalloc",
+    8: "kfree",
+    9: "fdc_read",
+    10: "fdc_done",
+}
+
+# entry event -> exit event, both carry the same key in arg1
+SPANS = {
+    2: (3, "irq"),
+    4: (5, "syscall"),
+    9: (10, "fdc"),
+}
+
+SYSCALLS = [
+    "null", "print", "exit", "open", "read", "write", "close", "lseek", "brk",
+    "mmap", "yield", "sleep", "getpid", "futex_wait", "futex_wake",
+    "ioring_setup", "ioring_enter",
+]
+
+RECORD = re.compile(r"#T (\d+) (\d+) (\d+) ([0-9a-fA-F]+) ([0-9a-fA-F]+)")
+BEGIN = re.compile(r"#TRACE begin (\d+)")
+
+
+def parse(lines):
+    khz, records = 0, []
+    for line in lines:
+        begin = BEGIN.search(line)
+        if begin:
+            khz, records = int(begin.group(1)), []
+            continue
+        match = RECORD.search(line)
+        if match:
+            cpu, ts, event = int(match.group(1)), int(match.group(2)), int(match.group(3))
+            records.append((ts, cpu, event, int(match.group(4), 16), int(match.group(5), 16)))
+    records.sort()
+    return khz, records
+
+
+def describe(event, arg1, arg2):
+    if event == 1:
+        return "pid %d -> pid %d" % (arg1, arg2)
+    if event in (2, 3):
+        return "irq %d" % arg1
+    if event in (4, 5):
+        name = SYSCALLS[arg1] if arg1 < len(SYSCALLS) else str(arg1)
+        if event == 4:
+            return "%s(0x%x)" % (name, arg2)
+        result = arg2 - (1 << 32) if arg2 & 0x80000000 else arg2
+        return "%s = %d" % (name, result)
+    if event == 6:
+        return "addr 0x%08x error 0x%x" % (arg1, arg2)
+    if event == 7:
+        return "%d bytes -> 0x%08x" % (arg1, arg2)
+    if event == 8:
+        return "0x%08x" % arg1
+    if event in (9, 10):
+        return "lba %d, %d sectors" % (arg1, arg2)
+    return "0x%x 0x%x" % (arg1, arg2)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a kernel trace dump into a timeline")
+    parser.add_argument("log", nargs="?", help="debugcon output, stdin by default")
+    parser.add_argument("-c", "--chrome", metavar="FILE", help="also write a chrome trace event file")
+    parser.add_argument("-q", "--quiet", action="store_true", help="summary only")
+    args = parser.parse_args()
+
+    source = open(args.log, errors="replace") if args.log else sys.stdin
+    khz, records = parse(source)
+    if not records:
+        sys.exit("no trace records found")
+
+    # without a tsc the kernel records nanoseconds
+    unit = "us"
+    scale = 1000.0 / khz if khz else 0.001
+    origin = records[0][0]
+
+    last = {}           # cpu -> timestamp of its previous event
+    open_spans = {}     # (cpu, entry event, key) -> start timestamp, stacked for nesting
+    spans = {}          # name -> list of raw durations
+    chrome = []
+
+    if not args.quiet:
+        print("%12s %10s  cpu  %-14s %s" % ("time " + unit, "delta", "event", "args"))
+
+    for ts, cpu, event, arg1, arg2 in records:
+        name = EVENTS.get(event, "event_%d" % event)
+        delta = ts - last.get(cpu, ts)
+        last[cpu] = ts
+
+        if not args.quiet:
+            print("%12.3f %10.3f  %3d  %-14s %s" % ((ts - origin) * scale, delta * scale, cpu, name, describe(event, arg1, arg2)))
+
+        micros = (ts - origin) * scale
+        if event in SPANS:
+            open_spans.setdefault((cpu, event, arg1), []).append(ts)
+            chrome.append({"name": SPANS[event][1] + " " + describe(event, arg1, arg2), "ph": "B", "ts": micros, "pid": 0, "tid": cpu})
+            continue
+
+        closed = False
+        for entry, (exit_event, span) in SPANS.items():
+            if event != exit_event:
+                continue
+            starts = open_spans.get((cpu, entry, arg1))
+            if starts:
+                spans.setdefault(span, []).append(ts - starts.pop())
+                chrome.append({"ph": "E", "ts": micros, "pid": 0, "tid": cpu})
+            closed = True
+
+        if not closed:
+            chrome.append({"name": name, "ph": "i", "s": "t", "ts": micros, "pid": 0, "tid": cpu,
+                           "args": {"info": describe(event, arg1, arg2)}})
+
+    print()
+    print("%d events on %d cpu(s) over %.3f %s" % (len(records), len(last), (records[-1][0] - origin) * scale, unit))
+    counts = {}
+    for record in records:
+        counts[record[2]] = counts.get(record[2], 0) + 1
+    for event in sorted(counts):
+        print("  %-14s %8d" % (EVENTS.get(event, "event_%d" % event), counts[event]))
+
+    if spans:
+        print()
+        print("  %-10s %8s %12s %12s %12s" % ("span", "count", "total", "avg", "max"))
+        for span, durations in sorted(spans.items()):
+            total = sum(durations)
+            print("  %-10s %8d %12.3f %12.3f %12.3f" % (span, len(durations), total * scale,
+                                                      total * scale / len(durations), max(durations) * scale))
+
+    if args.chrome:
+        with open(args.chrome, "w") as out:
+            json.dump({"traceEvents": chrome, "displayTimeUnit": "ns"}, out)
+
+
+if __name__ == "__main__":
+    main()